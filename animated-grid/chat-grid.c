@@ -19,7 +19,7 @@
 #include <glib/gi18n.h>
 
 #include "chat-grid.h"
-#include "ppg-animation.h"
+#include "gb-animation-group.h"
 
 G_DEFINE_TYPE(ChatGrid, chat_grid, GTK_TYPE_FIXED)
 
@@ -30,6 +30,7 @@ struct _ChatGridPrivate
 	guint column_spacing;
 	gboolean need_relayout;
 	guint stride;
+	GbAnimationGroup *relayout;
 };
 
 enum
@@ -41,7 +42,6 @@ enum
 };
 
 static GParamSpec *gParamSpecs[LAST_PROP];
-static GQuark      gQuarkAnimation;
 
 static void
 chat_grid_add (GtkContainer *parent,
@@ -116,7 +116,7 @@ chat_grid_size_allocate (GtkWidget     *widget,
                          GtkAllocation *allocation)
 {
 	ChatGridPrivate *priv;
-	PpgAnimation *anim;
+	GbAnimationGroup *group = NULL;
 	GtkWidget *child;
 	ChatGrid *grid = (ChatGrid *)widget;
 	GList *children;
@@ -157,6 +157,22 @@ chat_grid_size_allocate (GtkWidget     *widget,
 	 *       setting it right.
 	 */
 
+	/*
+	 * All the children move along one timeline, replacing the one from the
+	 * previous relayout. Those still on their way restart from where they
+	 * are.
+	 */
+	if (priv->relayout) {
+		gb_animation_stop(GB_ANIMATION(priv->relayout));
+		g_object_unref(priv->relayout);
+		priv->relayout = NULL;
+	}
+
+	if (!g_getenv("CHAT_DISABLE_ANIMATIONS")) {
+		group = gb_animation_group_new(GB_ANIMATION_EASE_IN_OUT_QUAD, 300);
+		g_object_ref_sink(group);
+	}
+
 	children = gtk_container_get_children(GTK_CONTAINER(widget));
 	width = allocation->width - (2 * border_width);
 	x = 0;
@@ -171,16 +187,9 @@ chat_grid_size_allocate (GtkWidget     *widget,
 		gtk_container_child_get(GTK_CONTAINER(grid), child,
 		                        "x", &cx, "y", &cy, NULL);
 		if (cx != x || cy != y) {
-			if (!g_getenv("CHAT_DISABLE_ANIMATIONS")) {
-				anim = g_object_get_qdata(G_OBJECT(child), gQuarkAnimation);
-				if (anim) {
-					ppg_animation_stop(anim);
-				}
-				anim = g_object_animate(child,
-				                        PPG_ANIMATION_EASE_IN_OUT_QUAD, 300,
-				                        "x", x, "y", y, NULL);
-				g_object_set_qdata_full(G_OBJECT(child), gQuarkAnimation,
-				                        g_object_ref(anim), g_object_unref);
+			if (group) {
+				gb_animation_group_add(group, child, "x", x, "y", y, NULL);
+				priv->relayout = group;
 			} else {
 				gtk_container_child_set(GTK_CONTAINER(grid), child,
 				                        "x", x, "y", y, NULL);
@@ -191,9 +200,38 @@ chat_grid_size_allocate (GtkWidget     *widget,
 
 	g_list_free(children);
 
+	if (priv->relayout) {
+		gb_animation_start(GB_ANIMATION(priv->relayout));
+	} else if (group) {
+		g_object_unref(group);
+	}
+
 	priv->need_relayout = FALSE;
 }
 
+/**
+ * chat_grid_dispose:
+ * @object: (in): A #ChatGrid.
+ *
+ * Stops the relayout animation before the children go away.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+chat_grid_dispose (GObject *object)
+{
+	ChatGridPrivate *priv = CHAT_GRID(object)->priv;
+
+	if (priv->relayout) {
+		gb_animation_stop(GB_ANIMATION(priv->relayout));
+		g_object_unref(priv->relayout);
+		priv->relayout = NULL;
+	}
+
+	G_OBJECT_CLASS(chat_grid_parent_class)->dispose(object);
+}
+
 /**
  * chat_grid_finalize:
  * @object: (in): A #ChatGrid.
@@ -287,6 +325,7 @@ chat_grid_class_init (ChatGridClass *klass)
 	GtkWidgetClass *widget_class;
 
 	object_class = G_OBJECT_CLASS(klass);
+	object_class->dispose = chat_grid_dispose;
 	object_class->finalize = chat_grid_finalize;
 	object_class->get_property = chat_grid_get_property;
 	object_class->set_property = chat_grid_set_property;
@@ -321,8 +360,6 @@ chat_grid_class_init (ChatGridClass *klass)
 		                  G_PARAM_READWRITE);
 	g_object_class_install_property(object_class, PROP_ROW_SPACING,
 	                                gParamSpecs[PROP_ROW_SPACING]);
-
-	gQuarkAnimation = g_quark_from_static_string("chat-grid-animation");
 }
 
 /**
@@ -34,6 +34,7 @@ struct _GbAnimBinPrivate
    guint last_child_height;
    guint last_child_width;
    GtkOrientation orientation;
+   gboolean hiding;
 };
 
 enum
@@ -88,24 +89,7 @@ gb_anim_bin_set_frame_rate (GbAnimBin *bin,
 }
 
 static void
-gb_anim_bin_cancel_animation (GbAnimBin *bin)
-{
-   GbAnimBinPrivate *priv;
-   GbAnimation *animation;
-
-   g_return_if_fail(GB_IS_ANIM_BIN(bin));
-
-   priv = bin->priv;
-
-   if ((animation = priv->animation)) {
-      priv->animation = NULL;
-      g_object_remove_weak_pointer(G_OBJECT(animation),
-                                   (gpointer *)&priv->animation);
-   }
-}
-
-static void
-gb_anim_bin_hide_done (GtkWidget *widget)
+gb_anim_bin_done (GtkWidget *widget)
 {
    GbAnimBinPrivate *priv;
    GbAnimBin *bin = (GbAnimBin *)widget;
@@ -114,7 +98,14 @@ gb_anim_bin_hide_done (GtkWidget *widget)
 
    priv = bin->priv;
 
-   GTK_WIDGET_CLASS(gb_anim_bin_parent_class)->hide(widget);
+   /*
+    * The same animation may have been turned around since it started, so
+    * finish whatever it was doing last.
+    */
+   if (priv->hiding) {
+      GTK_WIDGET_CLASS(gb_anim_bin_parent_class)->hide(widget);
+      priv->hiding = FALSE;
+   }
 
    if (priv->orientation == GTK_ORIENTATION_VERTICAL) {
       priv->last_child_height = 0;
@@ -127,6 +118,31 @@ gb_anim_bin_hide_done (GtkWidget *widget)
    g_object_unref(widget);
 }
 
+static void
+gb_anim_bin_animate (GbAnimBin *bin,
+                     gint       value)
+{
+   GbAnimBinPrivate *priv = bin->priv;
+   const gchar *property;
+
+   property = (priv->orientation == GTK_ORIENTATION_VERTICAL) ?
+               "height-request" : "width-request";
+
+   if (priv->animation) {
+      gb_animation_retarget(priv->animation, property, value, NULL);
+      return;
+   }
+
+   priv->animation =
+      gb_object_animate_full(bin, priv->mode, priv->duration, priv->fps,
+                             (GDestroyNotify)gb_anim_bin_done,
+                             g_object_ref(bin),
+                             property, value,
+                             NULL);
+   g_object_add_weak_pointer(G_OBJECT(priv->animation),
+                             (gpointer *)&priv->animation);
+}
+
 static void
 gb_anim_bin_hide (GtkWidget *widget)
 {
@@ -134,14 +150,27 @@ gb_anim_bin_hide (GtkWidget *widget)
    GtkAllocation alloc;
    GbAnimBin *bin = (GbAnimBin *)widget;
    GtkWidget *child;
+   gint value;
 
    g_return_if_fail(GB_IS_ANIM_BIN(bin));
 
    priv = bin->priv;
 
-   gb_anim_bin_cancel_animation(bin);
-
    if ((child = gtk_bin_get_child(GTK_BIN(bin)))) {
+      priv->hiding = TRUE;
+
+      if (priv->animation) {
+         if (priv->orientation == GTK_ORIENTATION_VERTICAL) {
+            gtk_widget_get_preferred_height(child, NULL, &value);
+            priv->last_child_height = value;
+         } else {
+            gtk_widget_get_preferred_width(child, NULL, &value);
+            priv->last_child_width = value;
+         }
+         gb_anim_bin_animate(bin, 0);
+         return;
+      }
+
       gtk_widget_get_allocation(child, &alloc);
 
       if (priv->orientation == GTK_ORIENTATION_VERTICAL) {
@@ -158,38 +187,12 @@ gb_anim_bin_hide (GtkWidget *widget)
          g_object_set(widget, "width-request", alloc.width, NULL);
       }
 
-      priv->animation =
-         gb_object_animate_full(widget, priv->mode, priv->duration, priv->fps,
-                                (GDestroyNotify)gb_anim_bin_hide_done,
-                                g_object_ref(widget),
-                                (priv->orientation == GTK_ORIENTATION_VERTICAL) ? "height-request" : "width-request", 0,
-                                NULL);
-      g_object_add_weak_pointer(G_OBJECT(priv->animation),
-                                (gpointer *)&priv->animation);
+      gb_anim_bin_animate(bin, 0);
    } else {
       GTK_WIDGET_CLASS(gb_anim_bin_parent_class)->hide(widget);
    }
 }
 
-static void
-gb_anim_bin_show_done (GtkWidget *widget)
-{
-   GbAnimBinPrivate *priv;
-   GbAnimBin *bin = (GbAnimBin *)widget;
-
-   g_return_if_fail(GB_IS_ANIM_BIN(widget));
-
-   priv = bin->priv;
-
-   if (priv->orientation == GTK_ORIENTATION_VERTICAL) {
-      g_object_set(widget, "height-request", -1, NULL);
-   } else {
-      g_object_set(widget, "width-request", -1, NULL);
-   }
-
-   g_object_unref(widget);
-}
-
 static void
 gb_anim_bin_show (GtkWidget *widget)
 {
@@ -202,13 +205,15 @@ gb_anim_bin_show (GtkWidget *widget)
 
    priv = bin->priv;
 
-   gb_anim_bin_cancel_animation(bin);
-
    if ((child = gtk_bin_get_child(GTK_BIN(bin)))) {
-      if (priv->orientation == GTK_ORIENTATION_VERTICAL) {
-         g_object_set(widget, "height-request", 0, NULL);
-      } else {
-         g_object_set(widget, "width-request", 0, NULL);
+      priv->hiding = FALSE;
+
+      if (!priv->animation) {
+         if (priv->orientation == GTK_ORIENTATION_VERTICAL) {
+            g_object_set(widget, "height-request", 0, NULL);
+         } else {
+            g_object_set(widget, "width-request", 0, NULL);
+         }
       }
 
       GTK_WIDGET_CLASS(gb_anim_bin_parent_class)->show(widget);
@@ -219,14 +224,7 @@ gb_anim_bin_show (GtkWidget *widget)
          gtk_widget_get_preferred_width(child, NULL, &value);
       }
 
-      priv->animation =
-         gb_object_animate_full(widget, priv->mode, priv->duration, priv->fps,
-                                (GDestroyNotify)gb_anim_bin_show_done,
-                                g_object_ref(widget),
-                                (priv->orientation == GTK_ORIENTATION_VERTICAL) ? "height-request" : "width-request", value,
-                                NULL);
-      g_object_add_weak_pointer(G_OBJECT(priv->animation),
-                                (gpointer *)&priv->animation);
+      gb_anim_bin_animate(bin, value);
    } else {
       GTK_WIDGET_CLASS(gb_anim_bin_parent_class)->show(widget);
    }
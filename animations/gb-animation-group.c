@@ -0,0 +1,117 @@
+/* gb-animation-group.c
+ *
+ * Copyright (C) 2011 Christian Hergert <chris@dronelabs.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gb-animation-group.h"
+
+
+/*
+ * A GbAnimationGroup is a timeline: a GbAnimation without a target of
+ * its own whose tweens belong to many objects. They share the start
+ * time, the alpha computed each frame and the "completed" signal, and
+ * their writes for a frame are applied together.
+ */
+
+
+G_DEFINE_TYPE(GbAnimationGroup, gb_animation_group, GB_TYPE_ANIMATION)
+
+
+/**
+ * gb_animation_group_new:
+ * @mode: (in): The animation mode.
+ * @duration_msec: (in): The duration in milliseconds.
+ *
+ * Creates a new, empty timeline. Add properties of any number of
+ * objects with gb_animation_group_add() then start it with
+ * gb_animation_start().
+ *
+ * Returns: (transfer floating): A #GbAnimationGroup.
+ * Side effects: None.
+ */
+GbAnimationGroup*
+gb_animation_group_new (GbAnimationMode mode,
+                        guint           duration_msec)
+{
+	g_return_val_if_fail(mode < GB_ANIMATION_LAST, NULL);
+
+	return g_object_new(GB_TYPE_ANIMATION_GROUP,
+	                    "duration", duration_msec,
+	                    "mode", mode,
+	                    NULL);
+}
+
+
+/**
+ * gb_animation_group_add:
+ * @group: (in): A #GbAnimationGroup.
+ * @target: (in): A #GObject.
+ * @first_property: (in): The first property to animate.
+ *
+ * Adds properties of @target to the timeline. They are given in a
+ * similar manner to g_object_set() and animate from their value when
+ * the group starts to the value given here.
+ *
+ * Returns: %TRUE if all the properties were added; otherwise %FALSE.
+ * Side effects: None.
+ */
+gboolean
+gb_animation_group_add (GbAnimationGroup *group,
+                        gpointer          target,
+                        const gchar      *first_property,
+                        ...)
+{
+	gboolean ret;
+	va_list args;
+
+	g_return_val_if_fail(GB_IS_ANIMATION_GROUP(group), FALSE);
+
+	va_start(args, first_property);
+	ret = gb_animation_add_valist(GB_ANIMATION(group), target,
+	                              first_property, args);
+	va_end(args);
+	return ret;
+}
+
+
+/**
+ * gb_animation_group_class_init:
+ * @klass: (in): A #GbAnimationGroupClass.
+ *
+ * Initializes the GObjectClass.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_group_class_init (GbAnimationGroupClass *klass)
+{
+}
+
+
+/**
+ * gb_animation_group_init:
+ * @group: (in): A #GbAnimationGroup.
+ *
+ * Initializes the #GbAnimationGroup instance.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_group_init (GbAnimationGroup *group)
+{
+}
@@ -0,0 +1,57 @@
+/* gb-animation-group.h
+ *
+ * Copyright (C) 2011 Christian Hergert <chris@dronelabs.com>
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GB_ANIMATION_GROUP_H
+#define GB_ANIMATION_GROUP_H
+
+#include "gb-animation.h"
+
+G_BEGIN_DECLS
+
+#define GB_TYPE_ANIMATION_GROUP            (gb_animation_group_get_type())
+#define GB_ANIMATION_GROUP(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GB_TYPE_ANIMATION_GROUP, GbAnimationGroup))
+#define GB_ANIMATION_GROUP_CONST(obj)      (G_TYPE_CHECK_INSTANCE_CAST ((obj), GB_TYPE_ANIMATION_GROUP, GbAnimationGroup const))
+#define GB_ANIMATION_GROUP_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  GB_TYPE_ANIMATION_GROUP, GbAnimationGroupClass))
+#define GB_IS_ANIMATION_GROUP(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GB_TYPE_ANIMATION_GROUP))
+#define GB_IS_ANIMATION_GROUP_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  GB_TYPE_ANIMATION_GROUP))
+#define GB_ANIMATION_GROUP_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GB_TYPE_ANIMATION_GROUP, GbAnimationGroupClass))
+
+typedef struct _GbAnimationGroup      GbAnimationGroup;
+typedef struct _GbAnimationGroupClass GbAnimationGroupClass;
+
+struct _GbAnimationGroup
+{
+	GbAnimation parent;
+};
+
+struct _GbAnimationGroupClass
+{
+	GbAnimationClass parent_class;
+};
+
+GType             gb_animation_group_get_type (void) G_GNUC_CONST;
+GbAnimationGroup* gb_animation_group_new      (GbAnimationMode   mode,
+                                               guint             duration_msec);
+gboolean          gb_animation_group_add      (GbAnimationGroup *group,
+                                               gpointer          target,
+                                               const gchar      *first_property,
+                                               ...) G_GNUC_NULL_TERMINATED;
+
+G_END_DECLS
+
+#endif /* GB_ANIMATION_GROUP_H */
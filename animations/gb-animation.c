@@ -16,26 +16,42 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cairo-gobject.h>
 #include <gobject/gvaluecollector.h>
 #include <gtk/gtk.h>
 #include <string.h>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "gb-animation.h"
 #include "gb-frame-source.h"
 
 
-#define TIMEVAL_TO_MSEC(t) (((t).tv_sec * 1000UL) + ((t).tv_usec / 1000UL))
 #define LAST_FUNDAMENTAL 64
-#define TWEEN(type)                                         \
+#define NO_SLOT          G_MAXUINT
+#define BEZIER_SAMPLES   256    /* Intervals in a baked bezier curve */
+#define SPRING_STEP      1000   /* Integration step in usec */
+#define SPRING_MAX_LAG   100000 /* Most time integrated in one frame */
+#define JITTER_BASE      250    /* Upper usec bound of the first jitter bucket */
+#define THROTTLE_MAX     3      /* Most frames skipped between two runs */
+#define THROTTLE_RAISE   3      /* Frames over budget before skipping more */
+#define THROTTLE_LOWER   30     /* Frames under budget before skipping less */
+#define POOL_MAX         64     /* Most finished animations kept for reuse */
+#define TWEEN(type, min, max)                               \
     static void                                             \
     tween_##type (const GValue *begin,                      \
                   const GValue *end,                        \
                   GValue *value,                            \
                   gdouble offset)                           \
     {                                                       \
-    	g##type x = g_value_get_##type(begin);              \
-    	g##type y = g_value_get_##type(end);                \
-    	g_value_set_##type(value, x + ((y - x) * offset));  \
+    	gdouble x = g_value_get_##type(begin);              \
+    	gdouble y = g_value_get_##type(end);                \
+    	gdouble v = x + ((y - x) * offset);                 \
+    	g_value_set_##type(value, CLAMP(v, min, max));      \
     }
 
 
@@ -48,25 +64,103 @@ typedef void    (*TweenFunc) (const GValue *begin,
                               GValue       *value,
                               gdouble       offset);
 
+typedef struct _Tween Tween;
+
+typedef void    (*TweenSetter) (gpointer      target,
+                                Tween        *tween,
+                                const GValue *value);
+
+struct _Tween
+{
+	gpointer     target;   /* Object owning the property */
+	gboolean     is_child; /* Does GParamSpec belong to parent widget */
+	GParamSpec  *pspec;    /* GParamSpec of target property */
+	GValue       begin;    /* Begin value in animation */
+	GValue       end;      /* End value in animation */
+	GValue       value;    /* Scratch value for the current frame */
+	TweenSetter  setter;   /* Applies value to the target */
+	gpointer     klass;    /* Class owning pspec for direct setters */
+	guint        slot;     /* Slot in the clock's TweenBatch, or NO_SLOT */
+	gboolean     retarget; /* Whether gb_animation_retarget() changes it */
+	gboolean     numeric;  /* Whether the spring state below is used */
+	gdouble      position; /* Spring position */
+	gdouble      velocity; /* Spring velocity, per second */
+	gdouble      goal;     /* Spring rest position */
+	gdouble      epsilon;  /* Distance from goal considered settled */
+	GArray      *keyframes; /* Keyframes sorted by offset, or NULL */
+	gboolean     keyed;    /* Whether end is the value of the last keyframe */
+};
+
+
+/*
+ * A value a tween passes through on its way to the end value, and the
+ * easing used to get there from the previous one.
+ */
+typedef struct
+{
+	gdouble         offset; /* Offset the value is reached at */
+	GbAnimationMode mode;   /* Easing from the previous keyframe */
+	GValue          value;  /* Value at offset */
+} Keyframe;
+
+
+/*
+ * Numeric tweens of the running animations, stored as parallel arrays
+ * of doubles so a whole frame can be interpolated in one pass. There is
+ * one batch per easing mode so the pass never branches on the mode.
+ */
+typedef struct
+{
+	gdouble  *begin;  /* Begin values */
+	gdouble  *delta;  /* End values minus begin values */
+	gdouble  *offset; /* Offset of the owning animation this frame */
+	gdouble  *value;  /* Interpolated values */
+	Tween   **tweens; /* Tween owning each slot */
+	guint     len;
+	guint     size;
+} TweenBatch;
+
+
+typedef struct _GbAnimationClock GbAnimationClock;
+
+
+/*
+ * A cubic-bezier easing curve baked into a table of alpha values at
+ * evenly spaced offsets. Curves are shared by all the animations using
+ * the same control points.
+ */
 typedef struct
 {
-	gboolean    is_child; /* Does GParamSpec belong to parent widget */
-	GParamSpec *pspec;    /* GParamSpec of target property */
-	GValue      begin;    /* Begin value in animation */
-	GValue      end;      /* End value in animation */
-} Tween;
+	gdouble x1, y1, x2, y2;                /* Control points */
+	guint   ref_count;
+	gdouble table[BEZIER_SAMPLES + 1];     /* Alpha at offset i / SAMPLES */
+} BezierCurve;
 
 
 struct _GbAnimationPrivate
 {
-	gpointer  target;        /* Target object to animate */
-	guint64   begin_msec;    /* Time in which animation started */
-	guint     duration_msec; /* Duration of animation */
-	guint     mode;          /* Tween mode */
-	guint     tween_handler; /* GSource performing tweens */
-	GArray   *tweens;        /* Array of tweens to perform */
-	guint     frame_rate;    /* The frame-rate to use */
-	guint     frame_count;   /* Counter for debugging frames rendered */
+	gpointer          target;        /* Target object to animate */
+	GPtrArray        *targets;       /* Distinct targets of the tweens */
+	gint64            begin_time;    /* Monotonic usec the animation started */
+	guint             duration_msec; /* Duration of animation */
+	guint             mode;          /* Tween mode */
+	GbAnimationClock *clock;         /* Clock driving the animation */
+	GList             link;          /* Link in the clock while running */
+	GArray           *tweens;        /* Array of tweens to perform */
+	gdouble           frame_rate;    /* The frame-rate to use */
+	gint64            last_frame;    /* Time of the previous tick, or 0 */
+	GbAnimationStats  stats;         /* Frame statistics */
+	gdouble           offset;        /* Offset computed for the current frame */
+	gboolean          prepared;      /* If batched values are for this frame */
+	BezierCurve      *curve;         /* Curve for cubic-bezier mode */
+	gdouble           stiffness;     /* Spring constant for spring mode */
+	gdouble           damping;       /* Damping coefficient for spring mode */
+	gint64            spring_time;   /* Time the springs are integrated to */
+	GtkWidget        *widget;        /* Widget showing non-widget targets */
+	GPtrArray        *watched;       /* Objects signaling when shown */
+	gboolean          hidden;        /* Off the clock while hidden */
+	guint             finish_source; /* Ends the animation while hidden */
+	GbAnimation      *pool_next;     /* Next animation in the pool */
 };
 
 
@@ -74,8 +168,10 @@ enum
 {
 	PROP_0,
 	PROP_DURATION,
+	PROP_DAMPING,
 	PROP_FRAME_RATE,
 	PROP_MODE,
+	PROP_STIFFNESS,
 	PROP_TARGET,
 };
 
@@ -83,28 +179,77 @@ enum
 enum
 {
 	TICK,
+	COMPLETED,
 	LAST_SIGNAL
 };
 
 
+/*
+ * A clock shared by running animations. Each animation owns the GList
+ * link it is queued with, so joining and leaving are O(1).
+ *
+ * Widgets are ticked by the GdkFrameClock of their toplevel so frames
+ * line up with the display refresh; there is one clock per frame clock.
+ * Everything else shares a clock driven by a GbFrameSource.
+ *
+ * When frames cost more than the clock can afford, intermediate frames
+ * are skipped; see gb_animation_clock_adapt().
+ */
+struct _GbAnimationClock
+{
+	GQueue         animations;  /* Running animations */
+	GList         *next;        /* Next link to tick during a dispatch */
+	guint          source;      /* GbFrameSource driving the clock */
+	gdouble        frame_rate;  /* Highest rate requested since the clock started */
+	GdkFrameClock *frame_clock; /* GdkFrameClock driving the clock, if any */
+	gboolean       updating;    /* Whether the update phase was requested */
+	TweenBatch     batches[GB_ANIMATION_LAST]; /* Numeric tweens by mode */
+	guint          n_frames;    /* Frames run, for debugging */
+	guint          n_flushes;   /* Display flushes, for debugging */
+	gint64         last_run;    /* Frame time of the last frame run, or 0 */
+	guint          throttle;    /* Frames skipped between two runs */
+	guint          skipped;     /* Frames skipped since the last run */
+	guint          over;        /* Consecutive frames over budget */
+	guint          under;       /* Consecutive frames under budget */
+};
+
+
 /*
  * Globals.
  */
 static AlphaFunc alpha_funcs[GB_ANIMATION_LAST] = { NULL };
 static TweenFunc tween_funcs[LAST_FUNDAMENTAL] = { NULL };
+static GHashTable *boxed_tween_funcs = NULL;
 static guint     signals[LAST_SIGNAL] = { 0 };
 static gboolean  debug = FALSE;
+static GbAnimationClock gClock = { G_QUEUE_INIT };
+static GHashTable *gCurves = NULL;
+static GbAnimationStats gStats = { 0 };
+static gboolean  gManualFrames = FALSE;
+static GbAnimation *gPool = NULL;
+static guint     gPoolSize = 0;
+static GQuark    gOverridesQuark = 0;
+static struct {
+	GParamSpec *pspec;                /* Property being probed */
+	gboolean    reached;              /* Installer's get_property ran */
+	void      (*get_property) (GObject *, guint, GValue *, GParamSpec *);
+} gProbe;
+#if GTK_CHECK_VERSION(3, 8, 0)
+static GQuark    gClockQuark = 0;
+#endif
 
 
 /*
- * Tweeners for basic types.
+ * Tweeners for basic types. They work in doubles so that decreasing
+ * unsigned values do not wrap, and clamp to the type since eased offsets
+ * may overshoot past 0.0 and 1.0.
  */
-TWEEN(int);
-TWEEN(uint);
-TWEEN(long);
-TWEEN(ulong);
-TWEEN(float);
-TWEEN(double);
+TWEEN(int, G_MININT, G_MAXINT);
+TWEEN(uint, 0, G_MAXUINT);
+TWEEN(long, G_MINLONG, G_MAXLONG);
+TWEEN(ulong, 0, G_MAXULONG);
+TWEEN(float, -G_MAXFLOAT, G_MAXFLOAT);
+TWEEN(double, -G_MAXDOUBLE, G_MAXDOUBLE);
 
 
 /**
@@ -200,382 +345,3437 @@ gb_animation_alpha_ease_in_out_quad (gdouble offset)
 
 
 /**
- * gb_animation_load_begin_values:
- * @animation: (in): A #GbAnimation.
+ * bezier_curve_sample:
+ * @p1: (in): The first control point coordinate.
+ * @p2: (in): The second control point coordinate.
+ * @t: (in): The curve parameter; 0.0 to 1.0.
  *
- * Load the begin values for all the properties we are about to
- * animate.
+ * Evaluates one coordinate of a cubic bezier from (0,0) to (1,1).
+ *
+ * Returns: The coordinate at @t.
+ * Side effects: None.
+ */
+static inline gdouble
+bezier_curve_sample (gdouble p1,
+                     gdouble p2,
+                     gdouble t)
+{
+	gdouble u = 1.0 - t;
+
+	return 3.0 * u * u * t * p1 + 3.0 * u * t * t * p2 + t * t * t;
+}
+
+
+/**
+ * bezier_curve_bake:
+ * @curve: (in): A #BezierCurve with its control points set.
+ *
+ * Fills the table of @curve. For each offset the curve parameter is
+ * found by bisection, which always converges since x grows with t when
+ * the control points lie within 0.0 and 1.0.
  *
  * Returns: None.
  * Side effects: None.
  */
 static void
-gb_animation_load_begin_values (GbAnimation *animation)
+bezier_curve_bake (BezierCurve *curve)
 {
-	GbAnimationPrivate *priv;
-	GtkContainer *container;
-	Tween *tween;
+	gdouble x;
+	gdouble lo;
+	gdouble hi;
+	gdouble t;
 	gint i;
+	gint j;
 
-	g_return_if_fail(GB_IS_ANIMATION(animation));
+	for (i = 0; i <= BEZIER_SAMPLES; i++) {
+		x = (gdouble)i / BEZIER_SAMPLES;
+		lo = 0.0;
+		hi = 1.0;
+		t = x;
+		for (j = 0; j < 40; j++) {
+			t = (lo + hi) / 2.0;
+			if (bezier_curve_sample(curve->x1, curve->x2, t) < x) {
+				lo = t;
+			} else {
+				hi = t;
+			}
+		}
+		curve->table[i] = bezier_curve_sample(curve->y1, curve->y2, t);
+	}
 
-	priv = animation->priv;
+	curve->table[0] = 0.0;
+	curve->table[BEZIER_SAMPLES] = 1.0;
+}
 
-	for (i = 0; i < priv->tweens->len; i++) {
-		tween = &g_array_index(priv->tweens, Tween, i);
-		g_value_reset(&tween->begin);
-		if (tween->is_child) {
-			container = GTK_CONTAINER(gtk_widget_get_parent(priv->target));
-			gtk_container_child_get_property(container, priv->target,
-			                                 tween->pspec->name,
-			                                 &tween->begin);
-		} else {
-			g_object_get_property(priv->target, tween->pspec->name,
-			                      &tween->begin);
-		}
+
+/**
+ * bezier_curve_hash:
+ * @key: (in): A #BezierCurve.
+ *
+ * Hashes the control points of a curve.
+ *
+ * Returns: A hash value.
+ * Side effects: None.
+ */
+static guint
+bezier_curve_hash (gconstpointer key)
+{
+	const BezierCurve *curve = key;
+
+	return g_double_hash(&curve->x1) ^ (g_double_hash(&curve->y1) << 1)
+	     ^ (g_double_hash(&curve->x2) << 2) ^ (g_double_hash(&curve->y2) << 3);
+}
+
+
+/**
+ * bezier_curve_equal:
+ * @a: (in): A #BezierCurve.
+ * @b: (in): A #BezierCurve.
+ *
+ * Compares the control points of two curves.
+ *
+ * Returns: %TRUE if the curves are the same.
+ * Side effects: None.
+ */
+static gboolean
+bezier_curve_equal (gconstpointer a,
+                    gconstpointer b)
+{
+	const BezierCurve *ca = a;
+	const BezierCurve *cb = b;
+
+	return ca->x1 == cb->x1 && ca->y1 == cb->y1 &&
+	       ca->x2 == cb->x2 && ca->y2 == cb->y2;
+}
+
+
+/**
+ * bezier_curve_get:
+ * @x1: (in): X of the first control point; 0.0 to 1.0.
+ * @y1: (in): Y of the first control point.
+ * @x2: (in): X of the second control point; 0.0 to 1.0.
+ * @y2: (in): Y of the second control point.
+ *
+ * Retrieves the baked curve for the control points, baking it if no
+ * animation uses it yet.
+ *
+ * Returns: (transfer full): A #BezierCurve.
+ * Side effects: The curve may be baked.
+ */
+static BezierCurve *
+bezier_curve_get (gdouble x1,
+                  gdouble y1,
+                  gdouble x2,
+                  gdouble y2)
+{
+	BezierCurve key = { x1, y1, x2, y2 };
+	BezierCurve *curve;
+
+	if (G_UNLIKELY(!gCurves)) {
+		gCurves = g_hash_table_new(bezier_curve_hash, bezier_curve_equal);
 	}
+
+	if ((curve = g_hash_table_lookup(gCurves, &key))) {
+		curve->ref_count++;
+		return curve;
+	}
+
+	curve = g_slice_new(BezierCurve);
+	curve->x1 = x1;
+	curve->y1 = y1;
+	curve->x2 = x2;
+	curve->y2 = y2;
+	curve->ref_count = 1;
+	bezier_curve_bake(curve);
+	g_hash_table_insert(gCurves, curve, curve);
+
+	return curve;
 }
 
 
 /**
- * gb_animation_unload_begin_values:
- * @animation: (in): A #GbAnimation.
+ * bezier_curve_unref:
+ * @curve: (in): A #BezierCurve.
  *
- * Unloads the begin values for the animation. This might be particularly
- * useful once we support pointer types.
+ * Drops a reference on @curve, freeing it once no animation uses it.
  *
  * Returns: None.
  * Side effects: None.
  */
 static void
-gb_animation_unload_begin_values (GbAnimation *animation)
+bezier_curve_unref (BezierCurve *curve)
 {
-	GbAnimationPrivate *priv;
-	Tween *tween;
-	gint i;
+	if (!--curve->ref_count) {
+		g_hash_table_remove(gCurves, curve);
+		g_slice_free(BezierCurve, curve);
+	}
+}
 
-	g_return_if_fail(GB_IS_ANIMATION(animation));
 
-	priv = animation->priv;
+/**
+ * bezier_curve_eval:
+ * @curve: (in): A #BezierCurve.
+ * @offset: (in): The position within the animation; 0.0 to 1.0.
+ *
+ * Looks up the alpha of @curve at @offset, interpolating between the
+ * two nearest samples.
+ *
+ * Returns: A transformation of @offset.
+ * Side effects: None.
+ */
+static inline gdouble
+bezier_curve_eval (const BezierCurve *curve,
+                   gdouble            offset)
+{
+	gdouble pos = CLAMP(offset, 0.0, 1.0) * BEZIER_SAMPLES;
+	guint idx = MIN((guint)pos, BEZIER_SAMPLES - 1);
+	gdouble frac = pos - idx;
 
-	for (i = 0; i < priv->tweens->len; i++) {
-		tween = &g_array_index(priv->tweens, Tween, i);
-		g_value_reset(&tween->begin);
+	return curve->table[idx] + (curve->table[idx + 1] - curve->table[idx]) * frac;
+}
+
+
+/**
+ * gb_animation_get_mode_alpha:
+ * @animation: (in): A #GbAnimation.
+ * @mode: (in): A #GbAnimationMode.
+ * @offset: (in): The position within the animation; 0.0 to 1.0.
+ *
+ * Transforms @offset using @mode, with the curve of @animation for
+ * cubic-bezier.
+ *
+ * Returns: A tranformation of @offset.
+ * Side effects: None.
+ */
+static inline gdouble
+gb_animation_get_mode_alpha (GbAnimation     *animation,
+                             GbAnimationMode  mode,
+                             gdouble          offset)
+{
+	if (mode == GB_ANIMATION_CUBIC_BEZIER && animation->priv->curve) {
+		return bezier_curve_eval(animation->priv->curve, offset);
 	}
+	return alpha_funcs[mode](offset);
 }
 
 
 /**
- * gb_animation_get_offset:
+ * gb_animation_get_alpha:
  * @animation: (in): A #GbAnimation.
+ * @offset: (in): The position within the animation; 0.0 to 1.0.
  *
- * Retrieves the position within the animation from 0.0 to 1.0. This
- * value is calculated using the msec of the beginning of the animation
- * and the current time.
+ * Transforms @offset using the mode of @animation.
  *
- * Returns: The offset of the animation from 0.0 to 1.0.
+ * Returns: A tranformation of @offset.
  * Side effects: None.
  */
-static gdouble
-gb_animation_get_offset (GbAnimation *animation)
+static inline gdouble
+gb_animation_get_alpha (GbAnimation *animation,
+                        gdouble      offset)
 {
-	GbAnimationPrivate *priv;
-	GTimeVal now;
-	guint64 msec;
-	gdouble offset;
+	return gb_animation_get_mode_alpha(animation, animation->priv->mode,
+	                                   offset);
+}
 
-	g_return_val_if_fail(GB_IS_ANIMATION(animation), 0.0);
 
-	priv = animation->priv;
+/**
+ * tween_value_get_double:
+ * @value: (in): A #GValue.
+ * @v_double: (out): A location for the value as a double.
+ *
+ * Reads a numeric #GValue as a double.
+ *
+ * Returns: %TRUE if @value holds a numeric type; otherwise %FALSE.
+ * Side effects: None.
+ */
+static gboolean
+tween_value_get_double (const GValue *value,
+                        gdouble      *v_double)
+{
+	switch (G_VALUE_TYPE(value)) {
+	case G_TYPE_INT:    *v_double = g_value_get_int(value);    return TRUE;
+	case G_TYPE_UINT:   *v_double = g_value_get_uint(value);   return TRUE;
+	case G_TYPE_LONG:   *v_double = g_value_get_long(value);   return TRUE;
+	case G_TYPE_ULONG:  *v_double = g_value_get_ulong(value);  return TRUE;
+	case G_TYPE_FLOAT:  *v_double = g_value_get_float(value);  return TRUE;
+	case G_TYPE_DOUBLE: *v_double = g_value_get_double(value); return TRUE;
+	default:
+		return FALSE;
+	}
+}
 
-	g_get_current_time(&now);
-	msec = TIMEVAL_TO_MSEC(now);
-	offset = (gdouble)(msec - priv->begin_msec)
-	       / (gdouble)priv->duration_msec;
-	return CLAMP(offset, 0.0, 1.0);
+
+/**
+ * tween_value_set_double:
+ * @value: (in): A #GValue holding a numeric type.
+ * @v_double: (in): The new value.
+ *
+ * Stores @v_double into a numeric #GValue, truncating like the tween
+ * functions do. Springs overshoot their goal, so integers are clamped
+ * to what their type can hold first; negative values would wrap around
+ * unsigned ones.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+tween_value_set_double (GValue  *value,
+                        gdouble  v_double)
+{
+	switch (G_VALUE_TYPE(value)) {
+	case G_TYPE_INT:    g_value_set_int(value, CLAMP(v_double, G_MININT, G_MAXINT));      break;
+	case G_TYPE_UINT:   g_value_set_uint(value, CLAMP(v_double, 0, G_MAXUINT));           break;
+	case G_TYPE_LONG:   g_value_set_long(value, CLAMP(v_double, G_MINLONG, G_MAXLONG));   break;
+	case G_TYPE_ULONG:  g_value_set_ulong(value, CLAMP(v_double, 0, G_MAXULONG));         break;
+	case G_TYPE_FLOAT:  g_value_set_float(value, v_double);  break;
+	case G_TYPE_DOUBLE: g_value_set_double(value, v_double); break;
+	default:
+		g_assert_not_reached();
+	}
 }
 
 
 /**
- * gb_animation_update_property:
- * @animation: (in): A #GbAnimation.
- * @target: (in): A #GObject.
- * @tween: (in): a #Tween containing the property.
- * @value: (in) The new value for the property.
+ * tween_batch_add:
+ * @batch: (in): A #TweenBatch.
+ * @tween: (in): A #Tween with its begin value loaded.
+ *
+ * Gives @tween a slot in @batch if it animates a numeric property.
+ *
+ * Returns: None.
+ * Side effects: @tween<!-- -->'s slot is set.
+ */
+static void
+tween_batch_add (TweenBatch *batch,
+                 Tween      *tween)
+{
+	gdouble begin;
+	gdouble end;
+
+	tween->slot = NO_SLOT;
+
+	if (tween->keyframes ||
+	    !tween_value_get_double(&tween->begin, &begin) ||
+	    !tween_value_get_double(&tween->end, &end)) {
+		return;
+	}
+
+	if (batch->len == batch->size) {
+		batch->size = MAX(16, batch->size * 2);
+		batch->begin = g_renew(gdouble, batch->begin, batch->size);
+		batch->delta = g_renew(gdouble, batch->delta, batch->size);
+		batch->offset = g_renew(gdouble, batch->offset, batch->size);
+		batch->value = g_renew(gdouble, batch->value, batch->size);
+		batch->tweens = g_renew(Tween *, batch->tweens, batch->size);
+	}
+
+	tween->slot = batch->len++;
+	batch->begin[tween->slot] = begin;
+	batch->delta[tween->slot] = end - begin;
+	batch->offset[tween->slot] = 0.0;
+	batch->value[tween->slot] = begin;
+	batch->tweens[tween->slot] = tween;
+}
+
+
+/**
+ * tween_batch_remove:
+ * @batch: (in): A #TweenBatch.
+ * @tween: (in): A #Tween.
+ *
+ * Releases the slot of @tween, moving the last slot into its place.
+ *
+ * Returns: None.
+ * Side effects: Another tween's slot may change.
+ */
+static void
+tween_batch_remove (TweenBatch *batch,
+                    Tween      *tween)
+{
+	guint slot = tween->slot;
+	guint last;
+
+	if (slot == NO_SLOT) {
+		return;
+	}
+
+	last = --batch->len;
+	if (slot != last) {
+		batch->begin[slot] = batch->begin[last];
+		batch->delta[slot] = batch->delta[last];
+		batch->offset[slot] = batch->offset[last];
+		batch->value[slot] = batch->value[last];
+		batch->tweens[slot] = batch->tweens[last];
+		batch->tweens[slot]->slot = slot;
+	}
+	tween->slot = NO_SLOT;
+}
+
+
+/**
+ * tween_batch_clear:
+ * @batch: (in): A #TweenBatch.
+ *
+ * Frees the storage of @batch.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+tween_batch_clear (TweenBatch *batch)
+{
+	g_free(batch->begin);
+	g_free(batch->delta);
+	g_free(batch->offset);
+	g_free(batch->value);
+	g_free(batch->tweens);
+	memset(batch, 0, sizeof *batch);
+}
+
+
+#if defined(__AVX__)
+typedef __m256d VDouble;
+#define V_WIDTH         4
+#define V_LOAD(p)       _mm256_loadu_pd(p)
+#define V_STORE(p,v)    _mm256_storeu_pd((p), (v))
+#define V_SET1(d)       _mm256_set1_pd(d)
+#define V_ADD(a,b)      _mm256_add_pd((a), (b))
+#define V_SUB(a,b)      _mm256_sub_pd((a), (b))
+#define V_MUL(a,b)      _mm256_mul_pd((a), (b))
+#define V_SELECT_LT(a,b,t,f) \
+	_mm256_blendv_pd((f), (t), _mm256_cmp_pd((a), (b), _CMP_LT_OQ))
+#elif defined(__SSE2__)
+typedef __m128d VDouble;
+#define V_WIDTH         2
+#define V_LOAD(p)       _mm_loadu_pd(p)
+#define V_STORE(p,v)    _mm_storeu_pd((p), (v))
+#define V_SET1(d)       _mm_set1_pd(d)
+#define V_ADD(a,b)      _mm_add_pd((a), (b))
+#define V_SUB(a,b)      _mm_sub_pd((a), (b))
+#define V_MUL(a,b)      _mm_mul_pd((a), (b))
+#define V_SELECT_LT(a,b,t,f) \
+	gb_animation_select_lt((a), (b), (t), (f))
+
+static inline VDouble
+gb_animation_select_lt (VDouble a,
+                        VDouble b,
+                        VDouble t,
+                        VDouble f)
+{
+	VDouble mask = _mm_cmplt_pd(a, b);
+	return _mm_or_pd(_mm_and_pd(mask, t), _mm_andnot_pd(mask, f));
+}
+#endif
+
+
+#ifdef V_WIDTH
+/**
+ * gb_animation_alpha_v:
+ * @mode: (in): A #GbAnimationMode.
+ * @offset: (in): Offsets within the animations; 0.0 to 1.0.
+ *
+ * Vector version of the alpha functions.
+ *
+ * Returns: A transformation of @offset.
+ * Side effects: None.
+ */
+static inline VDouble
+gb_animation_alpha_v (GbAnimationMode mode,
+                      VDouble         offset)
+{
+	VDouble one = V_SET1(1.0);
+	VDouble two = V_SET1(2.0);
+	VDouble half = V_SET1(0.5);
+	VDouble t;
+	VDouble u;
+
+	switch (mode) {
+	case GB_ANIMATION_EASE_IN_QUAD:
+		return V_MUL(offset, offset);
+	case GB_ANIMATION_EASE_OUT_QUAD:
+		return V_MUL(offset, V_SUB(two, offset));
+	case GB_ANIMATION_EASE_IN_OUT_QUAD:
+		t = V_MUL(offset, two);
+		u = V_SUB(t, one);
+		return V_SELECT_LT(t, one,
+		                   V_MUL(half, V_MUL(t, t)),
+		                   V_SUB(half, V_MUL(half, V_MUL(u, V_SUB(u, two)))));
+	case GB_ANIMATION_EASE_IN_CUBIC:
+		return V_MUL(offset, V_MUL(offset, offset));
+	case GB_ANIMATION_LINEAR:
+	default:
+		return offset;
+	}
+}
+#endif
+
+
+/**
+ * tween_batch_run:
+ * @batch: (in): A #TweenBatch.
+ * @mode: (in): The easing mode of every tween in @batch.
+ *
+ * Interpolates every slot of @batch for the offsets of this frame,
+ * several slots at a time when SSE2 or AVX is available.
+ *
+ * Returns: None.
+ * Side effects: The values of @batch are updated.
+ */
+static void
+tween_batch_run (TweenBatch      *batch,
+                 GbAnimationMode  mode)
+{
+	guint i = 0;
+
+#ifdef V_WIDTH
+	for (; i + V_WIDTH <= batch->len; i += V_WIDTH) {
+		VDouble alpha = gb_animation_alpha_v(mode, V_LOAD(batch->offset + i));
+		V_STORE(batch->value + i,
+		        V_ADD(V_LOAD(batch->begin + i),
+		              V_MUL(V_LOAD(batch->delta + i), alpha)));
+	}
+#endif
+
+	for (; i < batch->len; i++) {
+		batch->value[i] = batch->begin[i]
+		                + batch->delta[i] * alpha_funcs[mode](batch->offset[i]);
+	}
+}
+
+
+/**
+ * tween_lerp_doubles:
+ * @begin: (in): The begin components.
+ * @end: (in): The end components.
+ * @value: (out): The interpolated components.
+ * @n_components: (in): The number of components.
+ * @offset: (in): The position within the animation.
+ *
+ * Interpolates arrays of doubles component-wise, using the same vector
+ * instructions as the tween batches.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static inline void
+tween_lerp_doubles (const gdouble *begin,
+                    const gdouble *end,
+                    gdouble       *value,
+                    guint          n_components,
+                    gdouble        offset)
+{
+	guint i = 0;
+
+#ifdef V_WIDTH
+	VDouble t = V_SET1(offset);
+	VDouble b;
+
+	for (; i + V_WIDTH <= n_components; i += V_WIDTH) {
+		b = V_LOAD(begin + i);
+		V_STORE(value + i, V_ADD(b, V_MUL(V_SUB(V_LOAD(end + i), b), t)));
+	}
+#endif
+
+	for (; i < n_components; i++) {
+		value[i] = begin[i] + (end[i] - begin[i]) * offset;
+	}
+}
+
+
+/**
+ * tween_set_boxed:
+ * @value: (in): A #GValue holding a boxed type.
+ * @boxed: (in): The new contents.
+ * @size: (in): The size of the boxed structure.
+ *
+ * Stores @boxed into @value, reusing the copy @value already holds so
+ * that ticking does not allocate.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static inline void
+tween_set_boxed (GValue        *value,
+                 gconstpointer  boxed,
+                 gsize          size)
+{
+	gpointer dest;
+
+	if ((dest = g_value_get_boxed(value))) {
+		memcpy(dest, boxed, size);
+	} else {
+		g_value_set_boxed(value, boxed);
+	}
+}
+
+
+/**
+ * tween_rgba:
+ * @begin: (in): The begin #GdkRGBA.
+ * @end: (in): The end #GdkRGBA.
+ * @value: (out): The interpolated #GdkRGBA.
+ * @offset: (in): The position within the animation.
+ *
+ * Interpolates colours with premultiplied alpha so that fading from a
+ * transparent colour does not go through its hue.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+tween_rgba (const GValue *begin,
+            const GValue *end,
+            GValue       *value,
+            gdouble       offset)
+{
+	const GdkRGBA *b = g_value_get_boxed(begin);
+	const GdkRGBA *e = g_value_get_boxed(end);
+	gdouble pb[4];
+	gdouble pe[4];
+	gdouble pv[4];
+	GdkRGBA rgba;
+
+	pb[0] = b->red * b->alpha;
+	pb[1] = b->green * b->alpha;
+	pb[2] = b->blue * b->alpha;
+	pb[3] = b->alpha;
+	pe[0] = e->red * e->alpha;
+	pe[1] = e->green * e->alpha;
+	pe[2] = e->blue * e->alpha;
+	pe[3] = e->alpha;
+
+	tween_lerp_doubles(pb, pe, pv, 4, offset);
+
+	rgba.alpha = CLAMP(pv[3], 0.0, 1.0);
+	if (rgba.alpha > 0.0) {
+		rgba.red = CLAMP(pv[0] / rgba.alpha, 0.0, 1.0);
+		rgba.green = CLAMP(pv[1] / rgba.alpha, 0.0, 1.0);
+		rgba.blue = CLAMP(pv[2] / rgba.alpha, 0.0, 1.0);
+	} else {
+		rgba.red = rgba.green = rgba.blue = 0.0;
+	}
+
+	tween_set_boxed(value, &rgba, sizeof rgba);
+}
+
+
+/**
+ * tween_rectangle:
+ * @begin: (in): The begin #GdkRectangle.
+ * @end: (in): The end #GdkRectangle.
+ * @value: (out): The interpolated #GdkRectangle.
+ * @offset: (in): The position within the animation.
+ *
+ * Interpolates rectangles component-wise.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+tween_rectangle (const GValue *begin,
+                 const GValue *end,
+                 GValue       *value,
+                 gdouble       offset)
+{
+	const GdkRectangle *b = g_value_get_boxed(begin);
+	const GdkRectangle *e = g_value_get_boxed(end);
+	gdouble db[4] = { b->x, b->y, b->width, b->height };
+	gdouble de[4] = { e->x, e->y, e->width, e->height };
+	gdouble dv[4];
+	GdkRectangle rect;
+
+	tween_lerp_doubles(db, de, dv, 4, offset);
+
+	rect.x = dv[0];
+	rect.y = dv[1];
+	rect.width = MAX(0, (gint)dv[2]);
+	rect.height = MAX(0, (gint)dv[3]);
+
+	tween_set_boxed(value, &rect, sizeof rect);
+}
+
+
+/**
+ * tween_matrix:
+ * @begin: (in): The begin #cairo_matrix_t.
+ * @end: (in): The end #cairo_matrix_t.
+ * @value: (out): The interpolated #cairo_matrix_t.
+ * @offset: (in): The position within the animation.
+ *
+ * Interpolates affine matrices component-wise. This is exact for
+ * translations and scales; rotations are approximated.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+tween_matrix (const GValue *begin,
+              const GValue *end,
+              GValue       *value,
+              gdouble       offset)
+{
+	const cairo_matrix_t *b = g_value_get_boxed(begin);
+	const cairo_matrix_t *e = g_value_get_boxed(end);
+	cairo_matrix_t matrix;
+
+	tween_lerp_doubles(&b->xx, &e->xx, &matrix.xx, 6, offset);
+	tween_set_boxed(value, &matrix, sizeof matrix);
+}
+
+
+/**
+ * gb_animation_load_begin_values:
+ * @animation: (in): A #GbAnimation.
+ *
+ * Load the begin values for all the properties we are about to
+ * animate.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_load_begin_values (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv;
+	GtkContainer *container;
+	Tween *tween;
+	gint i;
+
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+
+	priv = animation->priv;
+
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		g_value_reset(&tween->begin);
+		if (tween->is_child) {
+			container = GTK_CONTAINER(gtk_widget_get_parent(tween->target));
+			gtk_container_child_get_property(container, tween->target,
+			                                 tween->pspec->name,
+			                                 &tween->begin);
+		} else {
+			g_object_get_property(tween->target, tween->pspec->name,
+			                      &tween->begin);
+		}
+		g_value_copy(&tween->begin, &tween->value);
+	}
+}
+
+
+/**
+ * gb_animation_unload_begin_values:
+ * @animation: (in): A #GbAnimation.
+ *
+ * Unloads the begin values for the animation. This might be particularly
+ * useful once we support pointer types.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_unload_begin_values (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv;
+	Tween *tween;
+	gint i;
+
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+
+	priv = animation->priv;
+
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		g_value_reset(&tween->begin);
+	}
+}
+
+
+/**
+ * gb_animation_get_offset:
+ * @animation: (in): A #GbAnimation.
+ * @frame_time: (in): The monotonic time of the frame in microseconds.
+ *
+ * Retrieves the position within the animation from 0.0 to 1.0. This
+ * value is calculated using the time the animation began and the
+ * time of the frame being drawn.
+ *
+ * Returns: The offset of the animation from 0.0 to 1.0.
+ * Side effects: None.
+ */
+static gdouble
+gb_animation_get_offset (GbAnimation *animation,
+                         gint64       frame_time)
+{
+	GbAnimationPrivate *priv;
+	gdouble offset;
+
+	g_return_val_if_fail(GB_IS_ANIMATION(animation), 0.0);
+
+	priv = animation->priv;
+
+	if (!priv->duration_msec) {
+		return 1.0;
+	}
+
+	offset = (gdouble)(frame_time - priv->begin_time)
+	       / (priv->duration_msec * 1000.0);
+	return CLAMP(offset, 0.0, 1.0);
+}
+
+
+/**
+ * gb_animation_set_property_by_name:
+ * @target: (in): A #GObject.
+ * @tween: (in): a #Tween containing the property.
+ * @value: (in) The new value for the property.
+ *
+ * Updates the value of a property on an object using @value. This is
+ * the fallback for properties without a direct setter.
+ *
+ * Returns: None.
+ * Side effects: The property of @target is updated.
+ */
+static void
+gb_animation_set_property_by_name (gpointer      target,
+                                   Tween        *tween,
+                                   const GValue *value)
+{
+	g_object_set_property(target, tween->pspec->name, value);
+}
+
+
+/**
+ * gb_animation_set_property_direct:
+ * @target: (in): A #GObject.
+ * @tween: (in): a #Tween containing the property.
+ * @value: (in) The new value for the property.
+ *
+ * Updates the value of a property by calling the set_property vfunc of
+ * the class that installed it, skipping the lookup by name done by
+ * g_object_set_property(). The tick has already validated the value
+ * against the pspec, since eased and spring values may overshoot.
+ *
+ * Returns: None.
+ * Side effects: The property of @target is updated.
+ */
+static void
+gb_animation_set_property_direct (gpointer      target,
+                                  Tween        *tween,
+                                  const GValue *value)
+{
+	GObjectClass *klass = tween->klass;
+
+	klass->set_property(target, tween->pspec->param_id, value, tween->pspec);
+#if GLIB_CHECK_VERSION(2, 42, 0)
+	if (!(tween->pspec->flags & G_PARAM_EXPLICIT_NOTIFY))
+#endif
+		g_object_notify_by_pspec(target, tween->pspec);
+}
+
+
+/**
+ * gb_animation_set_adjustment_value:
+ * @target: (in): A #GtkAdjustment.
+ * @tween: (in): a #Tween containing the property.
+ * @value: (in) The new value for the property.
+ *
+ * Fast path for #GtkAdjustment:value.
+ *
+ * Returns: None.
+ * Side effects: The value of @target is updated.
+ */
+static void
+gb_animation_set_adjustment_value (gpointer      target,
+                                   Tween        *tween,
+                                   const GValue *value)
+{
+	gtk_adjustment_set_value(target, g_value_get_double(value));
+}
+
+
+/**
+ * gb_animation_set_width_request:
+ * @target: (in): A #GtkWidget.
+ * @tween: (in): a #Tween containing the property.
+ * @value: (in) The new value for the property.
+ *
+ * Fast path for #GtkWidget:width-request. A request of -1 means the
+ * natural size, so overshooting below zero on the way to a real size
+ * holds at zero instead.
+ *
+ * Returns: None.
+ * Side effects: The size request of @target is updated.
+ */
+static void
+gb_animation_set_width_request (gpointer      target,
+                                Tween        *tween,
+                                const GValue *value)
+{
+	gint width = g_value_get_int(value);
+	gint height;
+
+	if (width < 0 && g_value_get_int(&tween->end) >= 0) {
+		width = 0;
+	}
+
+	gtk_widget_get_size_request(target, NULL, &height);
+	gtk_widget_set_size_request(target, width, height);
+}
+
+
+/**
+ * gb_animation_set_height_request:
+ * @target: (in): A #GtkWidget.
+ * @tween: (in): a #Tween containing the property.
+ * @value: (in) The new value for the property.
+ *
+ * Fast path for #GtkWidget:height-request. A request of -1 means the
+ * natural size, so overshooting below zero on the way to a real size
+ * holds at zero instead.
+ *
+ * Returns: None.
+ * Side effects: The size request of @target is updated.
+ */
+static void
+gb_animation_set_height_request (gpointer      target,
+                                 Tween        *tween,
+                                 const GValue *value)
+{
+	gint height = g_value_get_int(value);
+	gint width;
+
+	if (height < 0 && g_value_get_int(&tween->end) >= 0) {
+		height = 0;
+	}
+
+	gtk_widget_get_size_request(target, &width, NULL);
+	gtk_widget_set_size_request(target, width, height);
+}
+
+
+/**
+ * gb_animation_set_child_property:
+ * @target: (in): A #GtkWidget.
+ * @tween: (in): A #Tween containing the property.
+ * @value: (in): The new value for the property.
+ *
+ * Updates the value of the parent widget of the target to @value. The
+ * set_child_property vfunc of the container class is called directly
+ * unless the widget has since moved to a container of another type.
+ *
+ * Returns: None.
+ * Side effects: The property of @target<!-- -->'s parent widget is updated.
+ */
+static void
+gb_animation_set_child_property (gpointer      target,
+                                 Tween        *tween,
+                                 const GValue *value)
+{
+	GtkWidget *parent = gtk_widget_get_parent(GTK_WIDGET(target));
+	GtkContainerClass *klass = tween->klass;
+
+	if (!parent) {
+		return;
+	}
+
+#if GTK_CHECK_VERSION(3, 18, 0)
+	if (klass && G_TYPE_CHECK_INSTANCE_TYPE(parent, tween->pspec->owner_type)) {
+		klass->set_child_property(GTK_CONTAINER(parent), target,
+		                          tween->pspec->param_id, value,
+		                          tween->pspec);
+		gtk_container_child_notify_by_pspec(GTK_CONTAINER(parent), target,
+		                                    tween->pspec);
+		return;
+	}
+#endif
+
+	gtk_container_child_set_property(GTK_CONTAINER(parent), target,
+	                                 tween->pspec->name, value);
+}
+
+
+/**
+ * gb_animation_probe_get_property:
+ * @object: (in): A #GObject.
+ * @prop_id: (in): The property id.
+ * @value: (out): The property value.
+ * @pspec: (in): The #GParamSpec of the property.
+ *
+ * Stands in for the get_property vfunc of the installing class while
+ * gb_animation_is_overridden() reads a property.
+ *
+ * Returns: None.
+ * Side effects: Records whether the probed property got here.
+ */
+static void
+gb_animation_probe_get_property (GObject    *object,
+                                 guint       prop_id,
+                                 GValue     *value,
+                                 GParamSpec *pspec)
+{
+	if (pspec == gProbe.pspec && prop_id == gProbe.pspec->param_id) {
+		gProbe.reached = TRUE;
+	}
+	gProbe.get_property(object, prop_id, value, pspec);
+}
+
+
+/**
+ * gb_animation_is_overridden:
+ * @target: (in): A #GObject.
+ * @pspec: (in): A #GParamSpec of @target, as found by name.
+ *
+ * Checks whether a class of @target overrides @pspec, in which case
+ * GObject runs that class's set_property instead of the installer's.
+ * g_object_class_find_property() and g_object_class_list_properties()
+ * only ever show the installed #GParamSpec, so the override is found
+ * where it takes effect: the property is read once with the installing
+ * class's get_property wrapped, and overridden if the read went
+ * elsewhere. Targets that still run the installer's set_property skip
+ * the probe. Answers are cached per class.
+ *
+ * Returns: %TRUE if @pspec may be overridden.
+ * Side effects: None.
+ */
+static gboolean
+gb_animation_is_overridden (GObject    *target,
+                            GParamSpec *pspec)
+{
+	GObjectClass *klass = g_type_class_peek(pspec->owner_type);
+	GType type = G_OBJECT_TYPE(target);
+	GValue value = { 0 };
+	GHashTable *answers;
+	gpointer answer;
+
+	if (G_OBJECT_GET_CLASS(target)->set_property == klass->set_property) {
+		return FALSE;
+	}
+	if (!(pspec->flags & G_PARAM_READABLE)) {
+		return TRUE;
+	}
+
+	if (G_UNLIKELY(!gOverridesQuark)) {
+		gOverridesQuark = g_quark_from_static_string("gb-animation-overrides");
+	}
+	if (!(answers = g_type_get_qdata(type, gOverridesQuark))) {
+		answers = g_hash_table_new(g_direct_hash, g_direct_equal);
+		g_type_set_qdata(type, gOverridesQuark, answers);
+	}
+	if (g_hash_table_lookup_extended(answers, pspec, NULL, &answer)) {
+		return GPOINTER_TO_INT(answer);
+	}
+
+	gProbe.pspec = pspec;
+	gProbe.reached = FALSE;
+	gProbe.get_property = klass->get_property;
+	klass->get_property = gb_animation_probe_get_property;
+	g_value_init(&value, pspec->value_type);
+	g_object_get_property(target, pspec->name, &value);
+	klass->get_property = gProbe.get_property;
+	g_value_unset(&value);
+
+	g_hash_table_insert(answers, pspec, GINT_TO_POINTER(!gProbe.reached));
+
+	return !gProbe.reached;
+}
+
+
+/**
+ * gb_animation_resolve_setter:
+ * @animation: (in): A #GbAnimation.
+ * @tween: (in): A #Tween.
+ *
+ * Picks the cheapest way to apply @tween to the target once, so that
+ * ticks never look properties up by name. Inherited properties go
+ * straight to the set_property vfunc of the installing class, as
+ * GObject itself would. Interface and overridden properties, whose
+ * vfunc and param_id live elsewhere, keep going through
+ * g_object_set_property().
+ *
+ * Returns: None.
+ * Side effects: @tween<!-- -->'s setter is set.
+ */
+static void
+gb_animation_resolve_setter (GbAnimation *animation,
+                             Tween       *tween)
+{
+	GParamSpec *pspec = tween->pspec;
+	gpointer target = tween->target;
+
+	tween->klass = NULL;
+
+	if (tween->is_child) {
+		tween->setter = gb_animation_set_child_property;
+		if (!G_TYPE_IS_INTERFACE(pspec->owner_type)) {
+			tween->klass = g_type_class_peek(pspec->owner_type);
+		}
+		return;
+	}
+
+	if (GTK_IS_ADJUSTMENT(target) &&
+	    pspec->owner_type == GTK_TYPE_ADJUSTMENT &&
+	    !g_strcmp0(pspec->name, "value")) {
+		tween->setter = gb_animation_set_adjustment_value;
+	} else if (GTK_IS_WIDGET(target) &&
+	           pspec->owner_type == GTK_TYPE_WIDGET &&
+	           !g_strcmp0(pspec->name, "width-request")) {
+		tween->setter = gb_animation_set_width_request;
+	} else if (GTK_IS_WIDGET(target) &&
+	           pspec->owner_type == GTK_TYPE_WIDGET &&
+	           !g_strcmp0(pspec->name, "height-request")) {
+		tween->setter = gb_animation_set_height_request;
+	} else if (!G_TYPE_IS_INTERFACE(pspec->owner_type) &&
+	           !gb_animation_is_overridden(target, pspec)) {
+		tween->setter = gb_animation_set_property_direct;
+		tween->klass = g_type_class_peek(pspec->owner_type);
+	} else {
+		tween->setter = gb_animation_set_property_by_name;
+	}
+}
+
+
+/**
+ * tween_interpolate:
+ * @begin: (in): The value at offset 0.0.
+ * @end: (in): The value at offset 1.0.
+ * @value: (out): A #GValue of the same type.
+ * @offset: (in): The eased position between @begin and @end.
+ *
+ * Interpolates between two values of any type with a tween function.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+tween_interpolate (const GValue *begin,
+                   const GValue *end,
+                   GValue       *value,
+                   gdouble       offset)
+{
+	TweenFunc func;
+
+	if (value->g_type < LAST_FUNDAMENTAL) {
+		/*
+		 * If you hit the following assertion, you need to add a function
+		 * to create the new value at the given offset.
+		 */
+		g_assert(tween_funcs[value->g_type]);
+		tween_funcs[value->g_type](begin, end, value, offset);
+	} else if ((func = g_hash_table_lookup(boxed_tween_funcs,
+	                                       GSIZE_TO_POINTER(value->g_type))) &&
+	           g_value_get_boxed(begin) &&
+	           g_value_get_boxed(end)) {
+		func(begin, end, value, offset);
+	} else {
+		/*
+		 * Types without a tween function jump at the end.
+		 */
+		if (offset >= 1.0) {
+			g_value_copy(end, value);
+		}
+	}
+}
+
+
+/**
+ * gb_animation_get_value_at_offset:
+ * @animation: (in): A #GbAnimation.
+ * @offset: (in): The offset in the animation from 0.0 to 1.0.
+ * @tween: (in): A #Tween containing the property.
+ * @value: (out): A #GValue in which to store the property.
+ *
+ * Retrieves a value for a particular position within the animation.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_get_value_at_offset (GbAnimation *animation,
+                                   gdouble       offset,
+                                   Tween        *tween,
+                                   GValue       *value)
+{
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+	g_return_if_fail(tween != NULL);
+	g_return_if_fail(value != NULL);
+	g_return_if_fail(value->g_type == tween->pspec->value_type);
+
+	tween_interpolate(&tween->begin, &tween->end, value, offset);
+}
+
+
+/**
+ * gb_animation_get_keyframe_value:
+ * @animation: (in): A #GbAnimation.
+ * @offset: (in): The position within the animation, before easing.
+ * @tween: (in): A #Tween with keyframes.
+ * @value: (out): A #GValue of the tween's type.
+ *
+ * Retrieves the value of @tween at @offset, locating the keyframes
+ * around @offset with a binary search. The begin value comes before the
+ * first keyframe and the end value, eased with the mode of @animation,
+ * after the last one.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_get_keyframe_value (GbAnimation *animation,
+                                 gdouble      offset,
+                                 Tween       *tween,
+                                 GValue      *value)
+{
+	GArray *keyframes = tween->keyframes;
+	GbAnimationMode mode;
+	const Keyframe *prev = NULL;
+	const Keyframe *next = NULL;
+	gdouble from;
+	gdouble to;
+	gdouble t;
+	guint lo = 0;
+	guint hi = keyframes->len;
+	guint mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (g_array_index(keyframes, Keyframe, mid).offset < offset) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo > 0) {
+		prev = &g_array_index(keyframes, Keyframe, lo - 1);
+	}
+	if (lo < keyframes->len) {
+		next = &g_array_index(keyframes, Keyframe, lo);
+	}
+
+	from = prev ? prev->offset : 0.0;
+	to = next ? next->offset : 1.0;
+	mode = next ? next->mode : animation->priv->mode;
+	t = (to > from) ? CLAMP((offset - from) / (to - from), 0.0, 1.0) : 1.0;
+
+	tween_interpolate(prev ? &prev->value : &tween->begin,
+	                  next ? &next->value : &tween->end,
+	                  value,
+	                  gb_animation_get_mode_alpha(animation, mode, t));
+}
+
+
+/**
+ * tween_clear_keyframes:
+ * @tween: (in): A #Tween.
+ *
+ * Frees the keyframes of @tween, if any.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+tween_clear_keyframes (Tween *tween)
+{
+	gint i;
+
+	if (tween->keyframes) {
+		for (i = 0; i < tween->keyframes->len; i++) {
+			g_value_unset(&g_array_index(tween->keyframes, Keyframe, i).value);
+		}
+		g_array_unref(tween->keyframes);
+		tween->keyframes = NULL;
+	}
+}
+
+
+/**
+ * gb_animation_spring_init:
+ * @animation: (in): A #GbAnimation.
+ *
+ * Puts the springs of @animation at rest on their begin values.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_spring_init (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv = animation->priv;
+	Tween *tween;
+	gint i;
+
+	priv->spring_time = priv->begin_time;
+
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		tween->numeric = tween_value_get_double(&tween->begin, &tween->position) &&
+		                 tween_value_get_double(&tween->end, &tween->goal);
+		tween->velocity = 0.0;
+		if (tween->numeric) {
+			/*
+			 * Integer properties are done once they round to the goal; others
+			 * once they are within a thousandth of the distance travelled.
+			 */
+			tween->epsilon = MAX(ABS(tween->goal - tween->position) * 1e-3, 1e-4);
+			if (G_VALUE_TYPE(&tween->value) != G_TYPE_FLOAT &&
+			    G_VALUE_TYPE(&tween->value) != G_TYPE_DOUBLE) {
+				tween->epsilon = 0.5;
+			}
+		}
+	}
+}
+
+
+/**
+ * gb_animation_spring_step:
+ * @animation: (in): A #GbAnimation in spring mode.
+ * @frame_time: (in): The monotonic time of the frame in microseconds.
+ *
+ * Integrates the damped springs of @animation up to @frame_time in fixed
+ * steps with semi-implicit Euler, which stays stable and gives the same
+ * motion whatever the frame-rate. Values snap to their goal once both
+ * the distance and the velocity are negligible.
+ *
+ * Returns: %TRUE until every spring has settled.
+ * Side effects: The scratch values of the tweens are updated.
+ */
+static gboolean
+gb_animation_spring_step (GbAnimation *animation,
+                          gint64       frame_time)
+{
+	GbAnimationPrivate *priv = animation->priv;
+	const gdouble dt = SPRING_STEP / (gdouble)G_USEC_PER_SEC;
+	gboolean settled = TRUE;
+	gdouble accel;
+	Tween *tween;
+	gint i;
+
+	if (frame_time - priv->spring_time > SPRING_MAX_LAG) {
+		priv->spring_time = frame_time - SPRING_MAX_LAG;
+	}
+
+	for (; priv->spring_time + SPRING_STEP <= frame_time;
+	     priv->spring_time += SPRING_STEP) {
+		for (i = 0; i < priv->tweens->len; i++) {
+			tween = &g_array_index(priv->tweens, Tween, i);
+			if (tween->numeric) {
+				accel = priv->stiffness * (tween->goal - tween->position)
+				      - priv->damping * tween->velocity;
+				tween->velocity += accel * dt;
+				tween->position += tween->velocity * dt;
+			}
+		}
+	}
+
+	/*
+	 * Settled means less than epsilon away and moving less than epsilon
+	 * per frame at 60 fps.
+	 */
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		if (tween->numeric &&
+		    (ABS(tween->goal - tween->position) >= tween->epsilon ||
+		     ABS(tween->velocity) >= tween->epsilon * 60.0)) {
+			settled = FALSE;
+		}
+	}
+
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		if (!tween->numeric) {
+			if (settled) {
+				g_value_copy(&tween->end, &tween->value);
+			}
+		} else if (settled) {
+			tween->position = tween->goal;
+			tween->velocity = 0.0;
+			g_value_copy(&tween->end, &tween->value);
+		} else {
+			tween_value_set_double(&tween->value, tween->position);
+		}
+	}
+
+	return !settled;
+}
+
+
+/**
+ * gb_animation_prepare:
+ * @animation: (in): A #GbAnimation.
+ * @frame_time: (in): The monotonic time of the frame in microseconds.
+ *
+ * Computes the offset of @animation for the frame and hands it to the
+ * batched slots of its tweens.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_prepare (GbAnimation *animation,
+                      gint64       frame_time)
+{
+	GbAnimationPrivate *priv = animation->priv;
+	TweenBatch *batch = &priv->clock->batches[priv->mode];
+	gdouble offset;
+	Tween *tween;
+	gint i;
+
+	priv->offset = gb_animation_get_offset(animation, frame_time);
+	priv->prepared = TRUE;
+
+	/*
+	 * Bezier curves differ between animations, so their batch is linear
+	 * and is handed the already eased offset.
+	 */
+	offset = priv->offset;
+	if (priv->mode == GB_ANIMATION_CUBIC_BEZIER) {
+		offset = bezier_curve_eval(priv->curve, offset);
+	}
+
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		if (tween->slot != NO_SLOT) {
+			batch->offset[tween->slot] = offset;
+		}
+	}
+}
+
+
+/**
+ * gb_animation_stats_add_frame:
+ * @stats: (in): A #GbAnimationStats.
+ * @interval: (in): Usec since the previous frame, or 0 for the first.
+ * @period: (in): Usec between frames at the target frame-rate.
+ *
+ * Accounts for a frame in @stats. A frame that comes more than half a
+ * period late counts the periods it skipped as missed frames.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_stats_add_frame (GbAnimationStats *stats,
+                              gint64            interval,
+                              gint64            period)
+{
+	gint64 jitter;
+	guint bucket;
+
+	stats->n_frames++;
+
+	if (interval <= 0 || period <= 0) {
+		return;
+	}
+
+	if (interval > period + period / 2) {
+		stats->n_missed += (interval + period / 2) / period - 1;
+	}
+
+	jitter = ABS(interval - period);
+	for (bucket = 0; bucket < GB_ANIMATION_JITTER_BUCKETS - 1; bucket++) {
+		if (jitter < ((gint64)JITTER_BASE << bucket)) {
+			break;
+		}
+	}
+	stats->jitter[bucket]++;
+}
+
+
+/**
+ * gb_animation_widget_is_shown:
+ * @widget: (in): A #GtkWidget.
+ *
+ * Checks whether @widget may currently be seen: it must be drawable and
+ * overlap the visible area of every scrollable it is packed in.
+ *
+ * Returns: %TRUE if @widget may be on screen; otherwise %FALSE.
+ * Side effects: None.
+ */
+static gboolean
+gb_animation_widget_is_shown (GtkWidget *widget)
+{
+	GtkAllocation alloc;
+	GtkAllocation view;
+	GtkWidget *toplevel;
+	GtkWidget *ancestor;
+	gint x;
+	gint y;
+	gint vx;
+	gint vy;
+
+	if (!gtk_widget_is_drawable(widget)) {
+		return FALSE;
+	}
+
+	toplevel = gtk_widget_get_toplevel(widget);
+	gtk_widget_get_allocation(widget, &alloc);
+	if (!gtk_widget_translate_coordinates(widget, toplevel, 0, 0, &x, &y)) {
+		return TRUE;
+	}
+
+	for (ancestor = gtk_widget_get_parent(widget);
+	     ancestor;
+	     ancestor = gtk_widget_get_parent(ancestor)) {
+		if (!GTK_IS_SCROLLABLE(ancestor) ||
+		    !gtk_widget_translate_coordinates(ancestor, toplevel, 0, 0,
+		                                      &vx, &vy)) {
+			continue;
+		}
+		gtk_widget_get_allocation(ancestor, &view);
+		if (x >= vx + view.width || x + alloc.width <= vx ||
+		    y >= vy + view.height || y + alloc.height <= vy) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+/**
+ * gb_animation_is_shown:
+ * @animation: (in): A #GbAnimation.
+ *
+ * Checks whether any change made by @animation may be seen. A property
+ * of a widget is seen through the widget, a child property through the
+ * container laying the child out, and a property of another object
+ * through the widget given to gb_animation_set_widget(), if any.
+ *
+ * Returns: %TRUE unless every target of @animation is hidden.
+ * Side effects: None.
+ */
+static gboolean
+gb_animation_is_shown (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv = animation->priv;
+	GtkWidget *checked = NULL;
+	GtkWidget *widget;
+	Tween *tween;
+	gint i;
+
+	if (priv->widget) {
+		return gb_animation_widget_is_shown(priv->widget);
+	}
+
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		if (!GTK_IS_WIDGET(tween->target)) {
+			return TRUE;
+		}
+		widget = tween->is_child ? gtk_widget_get_parent(tween->target)
+		                         : tween->target;
+		if (widget && widget != checked) {
+			if (gb_animation_widget_is_shown(widget)) {
+				return TRUE;
+			}
+			checked = widget;
+		}
+	}
+
+	return !priv->tweens->len;
+}
+
+
+/**
+ * gb_animation_tick:
+ * @animation: (in): A #GbAnimation.
+ * @frame_time: (in): The monotonic time of the frame in microseconds.
+ *
+ * Moves the object properties to the next position in the animation.
+ *
+ * Returns: %TRUE if the animation has not completed; otherwise %FALSE.
+ * Side effects: None.
+ */
+static gboolean
+gb_animation_tick (GbAnimation *animation,
+                   gint64       frame_time)
+{
+	GbAnimationPrivate *priv;
+	TweenBatch *batch;
+	gboolean prepared;
+	gboolean running;
+	gdouble offset;
+	gdouble alpha;
+	gint64 interval;
+	gint64 period;
+	gint64 begin;
+	gint64 applied;
+	gint64 end;
+	Tween *tween;
+	gint i;
+
+	g_return_val_if_fail(GB_IS_ANIMATION(animation), FALSE);
+
+	priv = animation->priv;
+
+	begin = g_get_monotonic_time();
+	interval = priv->last_frame ? frame_time - priv->last_frame : 0;
+	period = priv->frame_rate > 0 ? G_USEC_PER_SEC / priv->frame_rate : 0;
+	priv->last_frame = frame_time;
+	gb_animation_stats_add_frame(&priv->stats, interval, period);
+	gb_animation_stats_add_frame(&gStats, interval, period);
+
+	prepared = priv->prepared;
+	priv->prepared = FALSE;
+
+	/*
+	 * Compute property values. Numeric tweens were interpolated in bulk by
+	 * the clock unless the animation started after the batches ran.
+	 */
+	if (priv->mode == GB_ANIMATION_SPRING) {
+		running = gb_animation_spring_step(animation, frame_time);
+	} else {
+		offset = prepared ? priv->offset
+		                  : gb_animation_get_offset(animation, frame_time);
+		running = (offset < 1.0);
+		alpha = gb_animation_get_alpha(animation, offset);
+		batch = &priv->clock->batches[priv->mode];
+		for (i = 0; i < priv->tweens->len; i++) {
+			tween = &g_array_index(priv->tweens, Tween, i);
+			if (prepared && tween->slot != NO_SLOT) {
+				tween_value_set_double(&tween->value,
+				                       batch->value[tween->slot]);
+			} else if (tween->keyframes) {
+				gb_animation_get_keyframe_value(animation, offset, tween,
+				                                &tween->value);
+			} else {
+				gb_animation_get_value_at_offset(animation, alpha, tween,
+				                                 &tween->value);
+			}
+		}
+	}
+
+	/*
+	 * Update property values. Notifications are held back so listeners
+	 * see every property of the frame updated at once, and containers get
+	 * one resize for all the children that moved.
+	 */
+	for (i = 0; i < priv->targets->len; i++) {
+		g_object_freeze_notify(g_ptr_array_index(priv->targets, i));
+		if (GTK_IS_WIDGET(g_ptr_array_index(priv->targets, i))) {
+			gtk_widget_freeze_child_notify(g_ptr_array_index(priv->targets, i));
+		}
+	}
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		/* Springs and eased curves overshoot what the property accepts. */
+		g_param_value_validate(tween->pspec, &tween->value);
+		tween->setter(tween->target, tween, &tween->value);
+	}
+	applied = g_get_monotonic_time();
+	for (i = priv->targets->len - 1; i >= 0; i--) {
+		if (GTK_IS_WIDGET(g_ptr_array_index(priv->targets, i))) {
+			gtk_widget_thaw_child_notify(g_ptr_array_index(priv->targets, i));
+		}
+		g_object_thaw_notify(g_ptr_array_index(priv->targets, i));
+	}
+
+	/*
+	 * Notify anyone interested in the tick signal.
+	 */
+	g_signal_emit(animation, signals[TICK], 0);
+
+	/*
+	 * Property notifications go out on thaw, so they count as handler
+	 * time along with the tick signal.
+	 */
+	end = g_get_monotonic_time();
+	priv->stats.tween_usec += applied - begin;
+	priv->stats.handler_usec += end - applied;
+	gStats.tween_usec += applied - begin;
+	gStats.handler_usec += end - applied;
+
+	return running;
+}
+
+
+/**
+ * gb_animation_clock_get_period:
+ * @clock: (in): A #GbAnimationClock.
+ *
+ * Gets the time between two frames of @clock: the refresh interval of
+ * its #GdkFrameClock, or the period of its frame source.
+ *
+ * Returns: The period in microseconds, or 0 if unknown.
+ * Side effects: None.
+ */
+static gint64
+gb_animation_clock_get_period (GbAnimationClock *clock)
+{
+#if GTK_CHECK_VERSION(3, 8, 0)
+	gint64 interval = 0;
+
+	if (clock->frame_clock) {
+		gdk_frame_clock_get_refresh_info(clock->frame_clock, 0, &interval,
+		                                 NULL);
+		return interval ? interval : G_USEC_PER_SEC / 60;
+	}
+#endif
+
+	return clock->frame_rate > 0 ? G_USEC_PER_SEC / clock->frame_rate : 0;
+}
+
+
+/**
+ * gb_animation_clock_adapt:
+ * @clock: (in): A #GbAnimationClock.
+ * @interval: (in): Usec since the previous frame run, or 0.
+ * @cost: (in): Usec spent running the frame.
+ *
+ * Adjusts how many frames @clock skips between two runs. A frame is over
+ * budget if running it took more than half the time until the next run,
+ * or if it came more than a period late because the main loop is busy
+ * with layout and drawing. A few of those in a row make the clock skip
+ * one more frame; a long stretch of cheap, punctual frames makes it skip
+ * one less. Offsets are computed from the time, so skipping frames only
+ * makes the motion coarser.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_clock_adapt (GbAnimationClock *clock,
+                          gint64            interval,
+                          gint64            cost)
+{
+	gint64 period;
+	gint64 budget;
+
+	if (gManualFrames || !interval ||
+	    !(period = gb_animation_clock_get_period(clock))) {
+		return;
+	}
+
+	budget = period * (clock->throttle + 1);
+
+	if (cost > budget / 2 || interval > budget + period) {
+		clock->under = 0;
+		if (++clock->over >= THROTTLE_RAISE &&
+		    clock->throttle < THROTTLE_MAX) {
+			clock->throttle++;
+			clock->over = 0;
+		}
+	} else if (clock->throttle &&
+	           cost < period * clock->throttle / 4 &&
+	           interval <= budget + period / 2) {
+		clock->over = 0;
+		if (++clock->under >= THROTTLE_LOWER) {
+			clock->throttle--;
+			clock->under = 0;
+		}
+	} else {
+		clock->over = 0;
+		clock->under = 0;
+	}
+}
+
+
+/**
+ * gb_animation_clock_run:
+ * @clock: (in): A #GbAnimationClock.
+ * @frame_time: (in): The monotonic time of the frame in microseconds.
+ *
+ * Moves every animation running on @clock to its next step. All the
+ * numeric tweens are interpolated up front, then each animation applies
+ * its values. Animations may stop themselves or others, or start new
+ * ones, from within their tick. Frames are skipped while the clock is
+ * throttled.
+ *
+ * Returns: None.
+ * Side effects: Finished animations are stopped.
+ */
+static void
+gb_animation_clock_run (GbAnimationClock *clock,
+                        gint64            frame_time)
+{
+	GbAnimation *animation;
+	GList *iter;
+	gint64 begin;
+	guint mode;
+
+	if (clock->skipped < clock->throttle && clock->animations.length) {
+		clock->skipped++;
+		gStats.n_skipped++;
+		return;
+	}
+	clock->skipped = 0;
+
+	begin = g_get_monotonic_time();
+
+	for (iter = clock->animations.head; iter; iter = iter->next) {
+		gb_animation_prepare(iter->data, frame_time);
+	}
+
+	for (mode = 0; mode < GB_ANIMATION_LAST; mode++) {
+		tween_batch_run(&clock->batches[mode], mode);
+	}
+
+	gStats.tween_usec += g_get_monotonic_time() - begin;
+
+	for (iter = clock->animations.head; iter; iter = clock->next) {
+		clock->next = iter->next;
+		animation = iter->data;
+		if (!gb_animation_tick(animation, frame_time)) {
+			g_object_ref(animation);
+			gb_animation_stop(animation);
+			g_signal_emit(animation, signals[COMPLETED], 0);
+			g_object_unref(animation);
+		}
+	}
+
+	clock->next = NULL;
+	clock->n_frames++;
+
+	gb_animation_clock_adapt(clock,
+	                         clock->last_run ? frame_time - clock->last_run : 0,
+	                         g_get_monotonic_time() - begin);
+	clock->last_run = frame_time;
+
+	if (!clock->animations.length) {
+		clock->last_run = 0;
+		clock->throttle = 0;
+		clock->over = 0;
+		clock->under = 0;
+	}
+}
+
+
+/**
+ * gb_animation_clock_flush:
+ * @clock: (in): A #GbAnimationClock.
+ *
+ * Flushes outstanding requests to the graphics server (in the case of X)
+ * once the whole frame has been applied. Clocks driven by a
+ * #GdkFrameClock leave this to the frame clock, which paints right
+ * after the update phase.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_clock_flush (GbAnimationClock *clock)
+{
+	GdkDisplay *display;
+
+	if (!clock->frame_clock && (display = gdk_display_get_default())) {
+		gdk_display_flush(display);
+		clock->n_flushes++;
+	}
+}
+
+
+/**
+ * gb_animation_clock_debug:
+ * @clock: (in): A #GbAnimationClock.
+ *
+ * Prints the frame and flush counts of @clock when it goes idle if
+ * GB_ANIMATION_DEBUG is set, then resets them.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_clock_debug (GbAnimationClock *clock)
+{
+	if (debug && clock->n_frames) {
+		g_print("Clock %p ran %u frames with %u flushes (%.2f per frame).\n",
+		        clock, clock->n_frames, clock->n_flushes,
+		        (gdouble)clock->n_flushes / clock->n_frames);
+	}
+
+	clock->n_frames = 0;
+	clock->n_flushes = 0;
+}
+
+
+/**
+ * gb_animation_clock_dispatch:
+ * @data: (in): The #GbAnimationClock.
+ *
+ * Timeout from the main loop to run the clock of animations that are
+ * not driven by a #GdkFrameClock.
+ *
+ * Returns: %TRUE while animations are running; otherwise %FALSE.
+ * Side effects: Finished animations are stopped.
+ */
+static gboolean
+gb_animation_clock_dispatch (gpointer data)
+{
+	GbAnimationClock *clock = data;
+	GSource *source = g_main_current_source();
+
+	gb_animation_clock_run(clock, gb_frame_source_get_time(source));
+	gb_animation_clock_flush(clock);
+
+	/*
+	 * A source replaced by a faster one during this dispatch has already
+	 * been destroyed; only the current source may retire the clock.
+	 */
+	if (!clock->animations.length &&
+	    g_source_get_id(source) == clock->source) {
+		clock->source = 0;
+		clock->frame_rate = 0;
+		gb_animation_clock_debug(clock);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+/**
+ * gb_animation_clock_join:
+ * @clock: (in): A #GbAnimationClock.
+ * @animation: (in): A #GbAnimation.
+ *
+ * Adds @animation to @clock, starting the clock if needed. A frame
+ * clock driven clock simply asks for the update phase every frame.
+ * Otherwise the clock runs at the highest frame-rate requested since
+ * it started; ticking an animation more often than asked is harmless
+ * since offsets are computed from the time. While a time function is
+ * installed, frames are only run by gb_animation_run_frame().
+ *
+ * Returns: None.
+ * Side effects: The frame source may be (re)created.
+ */
+static void
+gb_animation_clock_join (GbAnimationClock *clock,
+                         GbAnimation      *animation)
+{
+	GbAnimationPrivate *priv = animation->priv;
+	gint i;
+
+	priv->clock = clock;
+	priv->link.data = animation;
+	g_queue_push_tail_link(&clock->animations, &priv->link);
+
+	if (priv->mode != GB_ANIMATION_SPRING) {
+		for (i = 0; i < priv->tweens->len; i++) {
+			tween_batch_add(&clock->batches[priv->mode],
+			                &g_array_index(priv->tweens, Tween, i));
+		}
+	}
+
+#if GTK_CHECK_VERSION(3, 8, 0)
+	if (clock->frame_clock) {
+		if (!clock->updating) {
+			clock->updating = TRUE;
+			gdk_frame_clock_begin_updating(clock->frame_clock);
+		}
+		return;
+	}
+#endif
+
+	if (gManualFrames) {
+		return;
+	}
+
+	if (priv->frame_rate > clock->frame_rate) {
+		if (clock->source) {
+			g_source_remove(clock->source);
+		}
+		clock->frame_rate = priv->frame_rate;
+		clock->source = gb_frame_source_add(clock->frame_rate,
+		                                    gb_animation_clock_dispatch,
+		                                    clock);
+	}
+}
+
+
+/**
+ * gb_animation_clock_remove:
+ * @animation: (in): A #GbAnimation.
+ *
+ * Removes @animation from its clock. The clock notices it has nothing
+ * left to do on its next dispatch.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_clock_remove (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv = animation->priv;
+	GbAnimationClock *clock = priv->clock;
+	gint i;
+
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween_batch_remove(&clock->batches[priv->mode],
+		                   &g_array_index(priv->tweens, Tween, i));
+	}
+
+	if (clock->next == &priv->link) {
+		clock->next = priv->link.next;
+	}
+	g_queue_unlink(&clock->animations, &priv->link);
+	priv->link.data = NULL;
+	priv->clock = NULL;
+	priv->prepared = FALSE;
+}
+
+
+#if GTK_CHECK_VERSION(3, 8, 0)
+/**
+ * gb_animation_clock_update:
+ * @frame_clock: (in): A #GdkFrameClock.
+ * @clock: (in): The #GbAnimationClock driven by @frame_clock.
+ *
+ * Handles the "update" phase of @frame_clock by running the clock
+ * with the time of the frame about to be drawn.
+ *
+ * Returns: None.
+ * Side effects: Finished animations are stopped.
+ */
+static void
+gb_animation_clock_update (GdkFrameClock    *frame_clock,
+                           GbAnimationClock *clock)
+{
+	gb_animation_clock_run(clock, gdk_frame_clock_get_frame_time(frame_clock));
+
+	if (!clock->animations.length && clock->updating) {
+		clock->updating = FALSE;
+		gdk_frame_clock_end_updating(frame_clock);
+		gb_animation_clock_debug(clock);
+	}
+}
+
+
+/**
+ * gb_animation_clock_free:
+ * @data: (in): A #GbAnimationClock.
+ *
+ * Frees a clock once its #GdkFrameClock is finalized. Animations still
+ * running on it are handed over to the timeout driven clock.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_clock_free (gpointer data)
+{
+	GbAnimationClock *clock = data;
+	GbAnimation *animation;
+	GList *link;
+	guint mode;
+
+	while ((link = g_queue_peek_head_link(&clock->animations))) {
+		animation = link->data;
+		gb_animation_clock_remove(animation);
+		gb_animation_clock_join(&gClock, animation);
+	}
+
+	for (mode = 0; mode < GB_ANIMATION_LAST; mode++) {
+		tween_batch_clear(&clock->batches[mode]);
+	}
+
+	g_slice_free(GbAnimationClock, clock);
+}
+#endif
+
+
+/**
+ * gb_animation_clock_get:
+ * @animation: (in): A #GbAnimation.
+ *
+ * Finds the clock that should drive @animation: the one attached to the
+ * #GdkFrameClock of a realized target widget, or the timeout driven
+ * clock otherwise. Frame clocks run on display time, so the timeout
+ * driven clock is used for everything while a time function is
+ * installed.
+ *
+ * Returns: A #GbAnimationClock.
+ * Side effects: A clock may be created for the target's frame clock.
+ */
+static GbAnimationClock *
+gb_animation_clock_get (GbAnimation *animation)
+{
+#if GTK_CHECK_VERSION(3, 8, 0)
+	GbAnimationClock *clock;
+	GdkFrameClock *frame_clock;
+	GPtrArray *targets = animation->priv->targets;
+	gpointer target = animation->priv->target;
+
+	if (!target && targets->len) {
+		target = g_ptr_array_index(targets, 0);
+	}
+
+	if (gManualFrames || !GTK_IS_WIDGET(target) ||
+	    !(frame_clock = gtk_widget_get_frame_clock(target))) {
+		return &gClock;
+	}
+
+	if (G_UNLIKELY(!gClockQuark)) {
+		gClockQuark = g_quark_from_static_string("gb-animation-clock");
+	}
+
+	if (!(clock = g_object_get_qdata(G_OBJECT(frame_clock), gClockQuark))) {
+		clock = g_slice_new0(GbAnimationClock);
+		clock->frame_clock = frame_clock;
+		g_signal_connect(frame_clock, "update",
+		                 G_CALLBACK(gb_animation_clock_update), clock);
+		g_object_set_qdata_full(G_OBJECT(frame_clock), gClockQuark, clock,
+		                        gb_animation_clock_free);
+	}
+
+	return clock;
+#else
+	return &gClock;
+#endif
+}
+
+
+/**
+ * gb_animation_show:
+ * @animation: (in): A #GbAnimation put aside by gb_animation_hide().
+ *
+ * Puts @animation back on a clock. Offsets are computed from the time,
+ * so the targets jump to where they should be on the next frame.
+ *
+ * Returns: None.
+ * Side effects: The frame source may be (re)created.
+ */
+static void
+gb_animation_show (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv = animation->priv;
+
+	if (priv->finish_source) {
+		g_source_remove(priv->finish_source);
+		priv->finish_source = 0;
+	}
+
+	priv->hidden = FALSE;
+	priv->last_frame = 0;
+	gb_animation_clock_join(gb_animation_clock_get(animation), animation);
+}
+
+
+/**
+ * gb_animation_finish_hidden:
+ * @data: (in): A hidden #GbAnimation.
+ *
+ * Timeout ending an animation whose targets stayed hidden until its
+ * end. Springs have no end, so they are settled at once. The animation
+ * goes back on a clock for a single frame that applies the end values
+ * and completes it.
+ *
+ * Returns: %FALSE always.
+ * Side effects: None.
+ */
+static gboolean
+gb_animation_finish_hidden (gpointer data)
+{
+	GbAnimation *animation = data;
+	GbAnimationPrivate *priv = animation->priv;
+	Tween *tween;
+	gint i;
+
+	priv->finish_source = 0;
+
+	if (priv->mode == GB_ANIMATION_SPRING) {
+		for (i = 0; i < priv->tweens->len; i++) {
+			tween = &g_array_index(priv->tweens, Tween, i);
+			if (tween->numeric) {
+				tween->position = tween->goal;
+				tween->velocity = 0.0;
+			}
+		}
+	}
+
+	gb_animation_show(animation);
+
+	return FALSE;
+}
+
+
+/**
+ * gb_animation_schedule_finish:
+ * @animation: (in): A hidden #GbAnimation.
+ *
+ * (Re)schedules gb_animation_finish_hidden() for the time @animation
+ * ends.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_schedule_finish (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv = animation->priv;
+	gint64 remaining = 0;
+
+	if (priv->finish_source) {
+		g_source_remove(priv->finish_source);
+	}
+
+	if (priv->mode != GB_ANIMATION_SPRING) {
+		remaining = priv->begin_time + priv->duration_msec * 1000
+		          - gb_frame_source_get_time(NULL);
+	}
+
+	priv->finish_source = g_timeout_add(MAX(0, (remaining + 999) / 1000),
+	                                    gb_animation_finish_hidden,
+	                                    animation);
+}
+
+
+/**
+ * gb_animation_hide:
+ * @animation: (in): A #GbAnimation on a clock.
+ *
+ * Takes @animation off its clock while its targets cannot be seen, so
+ * it costs nothing per frame and an idle clock stops waking up. It is
+ * still running, and ends on time if it stays hidden.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_hide (GbAnimation *animation)
+{
+	gb_animation_clock_remove(animation);
+	animation->priv->hidden = TRUE;
+	gb_animation_schedule_finish(animation);
+}
+
+
+/**
+ * gb_animation_visibility_changed:
+ * @animation: (in): A running #GbAnimation.
+ * @instance: (in): The watched object that signaled.
+ *
+ * Handles a change that may show or hide the targets of @animation by
+ * taking it off its clock or putting it back.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_visibility_changed (GbAnimation *animation,
+                                 gpointer     instance)
+{
+	GbAnimationPrivate *priv = animation->priv;
+
+	if (priv->link.data) {
+		if (!gb_animation_is_shown(animation)) {
+			gb_animation_hide(animation);
+		}
+	} else if (priv->hidden && gb_animation_is_shown(animation)) {
+		gb_animation_show(animation);
+	}
+}
+
+
+/**
+ * gb_animation_watch_object:
+ * @animation: (in): A #GbAnimation.
+ * @instance: (in): A #GObject.
+ * @signals: (in): %NULL terminated signals telling that @instance moved
+ *   in or out of sight.
+ *
+ * Connects gb_animation_visibility_changed() to @signals of @instance,
+ * unless @instance is already watched.
+ *
+ * Returns: %TRUE if @instance was not watched yet; otherwise %FALSE.
+ * Side effects: A reference is held on @instance.
+ */
+static gboolean
+gb_animation_watch_object (GbAnimation        *animation,
+                           gpointer            instance,
+                           const gchar *const *signals)
+{
+	GPtrArray *watched = animation->priv->watched;
+	gint i;
+
+	for (i = 0; i < watched->len; i++) {
+		if (g_ptr_array_index(watched, i) == instance) {
+			return FALSE;
+		}
+	}
+
+	g_ptr_array_add(watched, g_object_ref(instance));
+	for (i = 0; signals[i]; i++) {
+		g_signal_connect_data(instance, signals[i],
+		                      G_CALLBACK(gb_animation_visibility_changed),
+		                      animation, NULL,
+		                      G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+	}
+
+	return TRUE;
+}
+
+
+/**
+ * gb_animation_watch_widget:
+ * @animation: (in): A #GbAnimation.
+ * @widget: (in): A #GtkWidget through which @animation is seen.
+ *
+ * Watches @widget being mapped and unmapped, and the scrolling of the
+ * scrollables it is packed in.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_watch_widget (GbAnimation *animation,
+                           GtkWidget   *widget)
+{
+	static const gchar *const widget_signals[] = { "map", "unmap", NULL };
+	static const gchar *const adjustment_signals[] = { "value-changed", NULL };
+	GtkAdjustment *adjustment;
+	GtkWidget *ancestor;
+
+	if (!gb_animation_watch_object(animation, widget, widget_signals)) {
+		return;
+	}
+
+	for (ancestor = gtk_widget_get_parent(widget);
+	     ancestor;
+	     ancestor = gtk_widget_get_parent(ancestor)) {
+		if (!GTK_IS_SCROLLABLE(ancestor)) {
+			continue;
+		}
+		adjustment = gtk_scrollable_get_hadjustment(GTK_SCROLLABLE(ancestor));
+		if (adjustment) {
+			gb_animation_watch_object(animation, adjustment,
+			                          adjustment_signals);
+		}
+		adjustment = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(ancestor));
+		if (adjustment) {
+			gb_animation_watch_object(animation, adjustment,
+			                          adjustment_signals);
+		}
+	}
+}
+
+
+/**
+ * gb_animation_unwatch:
+ * @animation: (in): A #GbAnimation.
+ *
+ * Disconnects from everything gb_animation_watch() connected to.
+ *
+ * Returns: None.
+ * Side effects: The watched objects are released.
+ */
+static void
+gb_animation_unwatch (GbAnimation *animation)
+{
+	GPtrArray *watched = animation->priv->watched;
+	gint i;
+
+	for (i = 0; i < watched->len; i++) {
+		g_signal_handlers_disconnect_by_func(g_ptr_array_index(watched, i),
+		                                     gb_animation_visibility_changed,
+		                                     animation);
+	}
+	g_ptr_array_set_size(watched, 0);
+}
+
+
+/**
+ * gb_animation_watch:
+ * @animation: (in): A running #GbAnimation.
+ *
+ * Watches the widgets through which @animation is seen, as decided by
+ * gb_animation_is_shown(), so it leaves its clock while they are hidden
+ * and comes back once they show up again. Visibility is only checked
+ * when they signal a change rather than every frame. Nothing is watched
+ * if a target is seen by other means, or while frames are run by hand.
+ *
+ * Returns: None.
+ * Side effects: @animation may be taken off its clock.
+ */
+static void
+gb_animation_watch (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv = animation->priv;
+	GtkWidget *widget;
+	Tween *tween;
+	gint i;
+
+	gb_animation_unwatch(animation);
+
+	if (gManualFrames) {
+		return;
+	}
+
+	if (priv->widget) {
+		gb_animation_watch_widget(animation, priv->widget);
+	} else {
+		for (i = 0; i < priv->tweens->len; i++) {
+			if (!GTK_IS_WIDGET(g_array_index(priv->tweens, Tween, i).target)) {
+				return;
+			}
+		}
+		for (i = 0; i < priv->tweens->len; i++) {
+			tween = &g_array_index(priv->tweens, Tween, i);
+			widget = tween->is_child ? gtk_widget_get_parent(tween->target)
+			                         : tween->target;
+			if (widget) {
+				gb_animation_watch_widget(animation, widget);
+			}
+		}
+	}
+
+	gb_animation_visibility_changed(animation, NULL);
+}
+
+
+/**
+ * gb_animation_start:
+ * @animation: (in): A #GbAnimation.
+ *
+ * Start the animation. When the animation stops, the internal reference will
+ * be dropped and the animation may be finalized.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+gb_animation_start (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv;
+
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+	g_return_if_fail(!animation->priv->link.data);
+	g_return_if_fail(!animation->priv->hidden);
+
+	priv = animation->priv;
+
+	g_object_ref_sink(animation);
+	gb_animation_load_begin_values(animation);
+
+	priv->begin_time = gb_frame_source_get_time(NULL);
+	priv->last_frame = 0;
+	if (priv->mode == GB_ANIMATION_CUBIC_BEZIER && !priv->curve) {
+		priv->curve = bezier_curve_get(0.25, 0.1, 0.25, 1.0);
+	}
+	if (priv->mode == GB_ANIMATION_SPRING) {
+		gb_animation_spring_init(animation);
+	}
+	gb_animation_clock_join(gb_animation_clock_get(animation), animation);
+	gb_animation_watch(animation);
+}
+
+
+/**
+ * gb_animation_stop:
+ * @animation: (in): A #GbAnimation.
+ *
+ * Stops a running animation. The internal reference to the animation is
+ * dropped and therefore may cause the object to finalize.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+gb_animation_stop (GbAnimation *animation)
+{
+	GbAnimationPrivate *priv;
+
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+
+	priv = animation->priv;
+
+	if (priv->link.data || priv->hidden) {
+		if (priv->link.data) {
+			gb_animation_clock_remove(animation);
+		}
+		if (priv->finish_source) {
+			g_source_remove(priv->finish_source);
+			priv->finish_source = 0;
+		}
+		priv->hidden = FALSE;
+		gb_animation_unwatch(animation);
+		gb_animation_unload_begin_values(animation);
+		g_object_unref(animation);
+	}
+}
+
+
+/**
+ * gb_animation_get_slope:
+ * @animation: (in): A #GbAnimation.
+ * @offset: (in): The position within the animation; 0.0 to 1.0.
+ *
+ * Approximates the derivative of the alpha function of @animation.
+ *
+ * Returns: The slope of the alpha function at @offset.
+ * Side effects: None.
+ */
+static gdouble
+gb_animation_get_slope (GbAnimation *animation,
+                        gdouble      offset)
+{
+	gdouble lo = MAX(0.0, offset - 1e-4);
+	gdouble hi = MIN(1.0, offset + 1e-4);
+
+	return (gb_animation_get_alpha(animation, hi) -
+	        gb_animation_get_alpha(animation, lo)) / (hi - lo);
+}
+
+
+/**
+ * gb_animation_solve_offset:
+ * @animation: (in): A #GbAnimation.
+ * @ratio: (in): The wanted slope / (1 - alpha).
+ *
+ * Finds where on the curve of @animation the ratio of the slope to the
+ * remaining distance is @ratio, which is where a tween re-based on its
+ * current value keeps its current velocity. The ratio grows along every
+ * curve, so a bisection does.
+ *
+ * Returns: An offset from 0.0 to 0.99.
+ * Side effects: None.
+ */
+static gdouble
+gb_animation_solve_offset (GbAnimation *animation,
+                           gdouble      ratio)
+{
+	gdouble lo = 0.0;
+	gdouble hi = 0.99;
+	gdouble mid;
+	gint i;
+
+#define RATIO(o) (gb_animation_get_slope(animation, (o)) / \
+                  (1.0 - gb_animation_get_alpha(animation, (o))))
+
+	if (!(ratio > RATIO(lo))) {
+		return lo;
+	}
+	if (ratio >= RATIO(hi)) {
+		return hi;
+	}
+
+	for (i = 0; i < 32; i++) {
+		mid = (lo + hi) / 2.0;
+		if (RATIO(mid) < ratio) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+#undef RATIO
+
+	return lo;
+}
+
+
+/**
+ * gb_animation_get_range:
+ * @tween: (in): A numeric #Tween.
+ * @clock: (in): The clock running the tween, or %NULL.
+ * @mode: (in): The mode of the animation.
+ * @begin: (out): The begin value.
+ * @delta: (out): The end value minus the begin value.
+ *
+ * Retrieves the range of a numeric tween, preferring the unrounded
+ * values of its batch slot.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_get_range (Tween            *tween,
+                        GbAnimationClock *clock,
+                        GbAnimationMode   mode,
+                        gdouble          *begin,
+                        gdouble          *delta)
+{
+	gdouble end;
+
+	if (clock && tween->slot != NO_SLOT) {
+		*begin = clock->batches[mode].begin[tween->slot];
+		*delta = clock->batches[mode].delta[tween->slot];
+	} else {
+		tween_value_get_double(&tween->begin, begin);
+		tween_value_get_double(&tween->end, &end);
+		*delta = end - *begin;
+	}
+}
+
+
+/**
+ * gb_animation_flatten_keyframes:
+ * @animation: (in): A #GbAnimation.
+ * @tween: (in): A #Tween with keyframes.
+ * @offset: (in): The current offset of @animation.
+ * @alpha: (in): @offset eased with the mode of @animation.
+ *
+ * Drops the keyframes of @tween, picking a begin value that keeps it
+ * where the keyframes put it at @offset.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+static void
+gb_animation_flatten_keyframes (GbAnimation *animation,
+                                Tween       *tween,
+                                gdouble      offset,
+                                gdouble      alpha)
+{
+	GValue current = { 0 };
+	gdouble value;
+	gdouble end;
+
+	g_value_init(&current, tween->pspec->value_type);
+	gb_animation_get_keyframe_value(animation, offset, tween, &current);
+	if (tween_value_get_double(&current, &value) &&
+	    tween_value_get_double(&tween->end, &end)) {
+		tween_value_set_double(&tween->begin, alpha < 1.0
+		                       ? (value - end * alpha) / (1.0 - alpha)
+		                       : value);
+	}
+	g_value_unset(&current);
+
+	tween_clear_keyframes(tween);
+}
+
+
+/**
+ * gb_animation_retarget:
+ * @animation: (in): A #GbAnimation.
+ * @first_property: (in): The first property to retarget.
+ *
+ * Changes the end values of properties already animated by @animation,
+ * given in a similar manner to g_object_set(). A running animation
+ * continues from where it is: numeric properties keep their current
+ * value and velocity and the animation is re-based so it ends one
+ * duration after the point on its curve matching that velocity.
+ *
+ * This does not allocate, so it is cheap enough to call for every
+ * event of a high resolution input device.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+gb_animation_retarget (GbAnimation *animation,
+                       const gchar *first_property,
+                       ...)
+{
+	GbAnimationPrivate *priv;
+	GbAnimationClock *clock;
+	const gchar *name;
+	gchar *error = NULL;
+	gint64 now;
+	gdouble offset = 0.0;
+	gdouble alpha = 0.0;
+	gdouble slope = 0.0;
+	gdouble lead = 0.0;
+	gdouble begin;
+	gdouble delta;
+	gdouble current;
+	gdouble end;
+	gdouble start = 0.0;
+	gboolean found;
+	va_list args;
+	Tween *tween;
+	gint i;
+
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+	g_return_if_fail(animation->priv->target);
+	g_return_if_fail(first_property != NULL);
+
+	priv = animation->priv;
+	clock = priv->clock;
+
+	for (i = 0; i < priv->tweens->len; i++) {
+		g_array_index(priv->tweens, Tween, i).retarget = FALSE;
+	}
+
+	/*
+	 * Collect the new end values into the scratch values, which are only
+	 * used during a tick.
+	 */
+	va_start(args, first_property);
+	for (name = first_property; name; name = va_arg(args, const gchar *)) {
+		found = FALSE;
+		for (i = 0; i < priv->tweens->len; i++) {
+			tween = &g_array_index(priv->tweens, Tween, i);
+			if (tween->target == priv->target &&
+			    !g_strcmp0(tween->pspec->name, name)) {
+				found = TRUE;
+				break;
+			}
+		}
+		if (!found) {
+			g_critical("%s is not animated by this animation", name);
+			break;
+		}
+		G_VALUE_COLLECT(&tween->value, args, 0, &error);
+		if (error != NULL) {
+			g_critical("Failed to retrieve va_list value: %s", error);
+			g_free(error);
+			break;
+		}
+		tween->retarget = TRUE;
+	}
+	va_end(args);
+
+	/*
+	 * Springs simply get a new rest position; they carry their velocity
+	 * over by nature. A hidden animation is still running.
+	 */
+	if ((!priv->link.data && !priv->hidden) ||
+	    priv->mode == GB_ANIMATION_SPRING) {
+		for (i = 0; i < priv->tweens->len; i++) {
+			tween = &g_array_index(priv->tweens, Tween, i);
+			if (tween->retarget) {
+				g_value_copy(&tween->value, &tween->end);
+				if ((priv->link.data || priv->hidden) && tween->numeric) {
+					tween_value_get_double(&tween->end, &tween->goal);
+				}
+			}
+		}
+		return;
+	}
+
+	now = gb_frame_source_get_time(NULL);
+	offset = gb_animation_get_offset(animation, now);
+	alpha = gb_animation_get_alpha(animation, offset);
+	slope = gb_animation_get_slope(animation, offset);
+
+	/*
+	 * Tweens leave their keyframes behind, continuing as plain tweens
+	 * through the value the keyframes have brought them to.
+	 */
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		if (tween->retarget && tween->keyframes) {
+			gb_animation_flatten_keyframes(animation, tween, offset, alpha);
+		}
+	}
+
+	/*
+	 * The animation has a single timeline, so the tween with the furthest
+	 * to go decides where on the curve to resume. The others keep their
+	 * value but their velocity only approximately.
+	 */
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		if (!tween->retarget ||
+		    !tween_value_get_double(&tween->value, &end)) {
+			continue;
+		}
+		gb_animation_get_range(tween, clock, priv->mode, &begin, &delta);
+		current = begin + delta * alpha;
+		if (ABS(end - current) > ABS(lead)) {
+			lead = end - current;
+			start = gb_animation_solve_offset(animation,
+			                                  delta * slope / lead);
+		}
+	}
+
+	alpha = gb_animation_get_alpha(animation, start);
+
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		if (!tween->retarget) {
+			continue;
+		}
+		if (!tween_value_get_double(&tween->value, &end)) {
+			g_value_copy(&tween->value, &tween->end);
+			continue;
+		}
+		gb_animation_get_range(tween, clock, priv->mode, &begin, &delta);
+		current = begin + delta * gb_animation_get_alpha(animation, offset);
+
+		/*
+		 * Pick the begin value that puts the tween on @current at @start.
+		 */
+		begin = end - (end - current) / (1.0 - alpha);
+		g_value_copy(&tween->value, &tween->end);
+		tween_value_set_double(&tween->begin, begin);
+		if (tween->slot != NO_SLOT) {
+			clock->batches[priv->mode].begin[tween->slot] = begin;
+			clock->batches[priv->mode].delta[tween->slot] = end - begin;
+		}
+	}
+
+	priv->begin_time = now - (gint64)(start * priv->duration_msec * 1000.0);
+
+	if (priv->hidden) {
+		gb_animation_schedule_finish(animation);
+	}
+}
+
+
+/**
+ * gb_animation_set_widget:
+ * @animation: (in): A #GbAnimation.
+ * @widget: (in) (allow-none): A #GtkWidget or %NULL.
+ *
+ * Sets the widget through which the changes made by @animation are
+ * seen, such as the widget drawing an adjustment being animated.
+ * Animations leave their clock while their targets are hidden, and
+ * by default this is decided from the targets themselves; objects that
+ * are not widgets are always considered shown.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+gb_animation_set_widget (GbAnimation *animation,
+                         GtkWidget   *widget)
+{
+	GbAnimationPrivate *priv;
+
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+	g_return_if_fail(!widget || GTK_IS_WIDGET(widget));
+
+	priv = animation->priv;
+
+	if (priv->widget) {
+		g_object_remove_weak_pointer(G_OBJECT(priv->widget),
+		                             (gpointer *)&priv->widget);
+	}
+	if ((priv->widget = widget)) {
+		g_object_add_weak_pointer(G_OBJECT(widget), (gpointer *)&priv->widget);
+	}
+
+	if (priv->link.data || priv->hidden) {
+		gb_animation_watch(animation);
+	}
+}
+
+
+/**
+ * gb_animation_set_time_func:
+ * @func: (allow-none): A function returning the monotonic time in usec.
+ * @user_data: (in): Data for @func.
+ *
+ * Installs a clock for animations to read the time from, or restores
+ * the real clock if @func is %NULL. While a clock is installed the
+ * animations do not tick on their own; the caller advances its clock
+ * and runs each frame synchronously with gb_animation_run_frame(). This
+ * lets tests and benchmarks run at full speed with reproducible frames.
+ *
+ * It should be called while no animation is running on a
+ * #GdkFrameClock.
+ *
+ * Returns: None.
+ * Side effects: The frame source of running animations is replaced.
+ */
+void
+gb_animation_set_time_func (GbAnimationTimeFunc func,
+                            gpointer            user_data)
+{
+	GbAnimation *animation;
+	GList *iter;
+
+	gb_frame_source_set_time_func(func, user_data);
+	gManualFrames = (func != NULL);
+
+	if (gClock.source) {
+		g_source_remove(gClock.source);
+		gClock.source = 0;
+		gClock.frame_rate = 0;
+	}
+
+	if (!gManualFrames) {
+		for (iter = gClock.animations.head; iter; iter = iter->next) {
+			animation = iter->data;
+			gClock.frame_rate = MAX(gClock.frame_rate,
+			                        animation->priv->frame_rate);
+		}
+		if (gClock.frame_rate > 0) {
+			gClock.source = gb_frame_source_add(gClock.frame_rate,
+			                                    gb_animation_clock_dispatch,
+			                                    &gClock);
+		}
+	}
+}
+
+
+/**
+ * gb_animation_run_frame:
+ *
+ * Runs a frame of the animations not driven by a #GdkFrameClock at the
+ * current time of the clock installed with gb_animation_set_time_func().
+ *
+ * Returns: None.
+ * Side effects: Finished animations are stopped.
+ */
+void
+gb_animation_run_frame (void)
+{
+	gb_animation_clock_run(&gClock, gb_frame_source_get_time(NULL));
+	gb_animation_clock_flush(&gClock);
+
+	if (!gClock.animations.length) {
+		gb_animation_clock_debug(&gClock);
+	}
+}
+
+
+/**
+ * gb_animation_get_stats:
+ * @animation: (in) (allow-none): A #GbAnimation or %NULL.
+ * @stats: (out): A location for the statistics.
+ *
+ * Retrieves the frame statistics of @animation since it was created, or
+ * of every animation since the last call to
+ * gb_animation_reset_stats() if @animation is %NULL. Time spent
+ * interpolating in bulk for all the animations of a clock only counts
+ * towards the global statistics.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+gb_animation_get_stats (GbAnimation      *animation,
+                        GbAnimationStats *stats)
+{
+	g_return_if_fail(!animation || GB_IS_ANIMATION(animation));
+	g_return_if_fail(stats != NULL);
+
+	*stats = animation ? animation->priv->stats : gStats;
+}
+
+
+/**
+ * gb_animation_reset_stats:
+ *
+ * Clears the global frame statistics.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+gb_animation_reset_stats (void)
+{
+	memset(&gStats, 0, sizeof gStats);
+}
+
+
+/**
+ * gb_animation_dump_stats:
+ * @animation: (in) (allow-none): A #GbAnimation or %NULL.
+ *
+ * Prints the frame statistics of @animation, or the global statistics
+ * if @animation is %NULL, to standard output. This is also done for
+ * each animation when it is finalized if GB_ANIMATION_DEBUG is set.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+gb_animation_dump_stats (GbAnimation *animation)
+{
+	GbAnimationStats stats;
+	guint i;
+
+	g_return_if_fail(!animation || GB_IS_ANIMATION(animation));
+
+	gb_animation_get_stats(animation, &stats);
+
+	if (animation) {
+		g_print("Animation %p (%u msec at %.1f fps):\n", animation,
+		        animation->priv->duration_msec, animation->priv->frame_rate);
+	} else {
+		g_print("All animations:\n");
+	}
+	g_print("  %u frames, %u missed, %u skipped under load\n",
+	        stats.n_frames, stats.n_missed, stats.n_skipped);
+	g_print("  %.3f msec tweening, %.3f msec in handlers\n",
+	        stats.tween_usec / 1000.0, stats.handler_usec / 1000.0);
+	g_print("  jitter:");
+	for (i = 0; i < GB_ANIMATION_JITTER_BUCKETS - 1; i++) {
+		g_print(" <%gms %u", (JITTER_BASE << i) / 1000.0, stats.jitter[i]);
+	}
+	g_print(" >=%gms %u\n", (JITTER_BASE << (i - 1)) / 1000.0,
+	        stats.jitter[i]);
+}
+
+
+/**
+ * gb_animation_register_tween_func:
+ * @type: (in): A boxed #GType.
+ * @func: (in): A function interpolating two values of @type.
+ *
+ * Registers how to interpolate properties of a boxed type, so that one
+ * animation can drive a whole structure. @func is given non-%NULL begin
+ * and end values and should store its result into the value it is
+ * given, reusing the boxed copy it may already hold. #GdkRGBA,
+ * #GdkRectangle and #cairo_matrix_t are supported out of the box.
+ *
+ * Returns: None.
+ * Side effects: Replaces any function registered for @type.
+ */
+void
+gb_animation_register_tween_func (GType                type,
+                                  GbAnimationTweenFunc func)
+{
+	g_return_if_fail(G_TYPE_FUNDAMENTAL(type) == G_TYPE_BOXED);
+	g_return_if_fail(func != NULL);
+
+	g_type_class_unref(g_type_class_ref(GB_TYPE_ANIMATION));
+	g_hash_table_insert(boxed_tween_funcs, GSIZE_TO_POINTER(type), func);
+}
+
+
+/**
+ * gb_animation_set_cubic_bezier:
+ * @animation: (in): A #GbAnimation in %GB_ANIMATION_CUBIC_BEZIER mode.
+ * @x1: (in): X of the first control point; 0.0 to 1.0.
+ * @y1: (in): Y of the first control point.
+ * @x2: (in): X of the second control point; 0.0 to 1.0.
+ * @y2: (in): Y of the second control point.
+ *
+ * Sets the easing curve of @animation like the CSS cubic-bezier()
+ * timing function. Without it, the curve of CSS "ease" is used. The
+ * curve is baked once and shared with animations using the same
+ * points. It may be changed while the animation runs, for example right
+ * after gb_object_animate().
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+gb_animation_set_cubic_bezier (GbAnimation *animation,
+                               gdouble      x1,
+                               gdouble      y1,
+                               gdouble      x2,
+                               gdouble      y2)
+{
+	GbAnimationPrivate *priv;
+	BezierCurve *curve;
+
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+	g_return_if_fail(animation->priv->mode == GB_ANIMATION_CUBIC_BEZIER);
+	g_return_if_fail(x1 >= 0.0 && x1 <= 1.0);
+	g_return_if_fail(x2 >= 0.0 && x2 <= 1.0);
+
+	priv = animation->priv;
+
+	curve = bezier_curve_get(x1, y1, x2, y2);
+	if (priv->curve) {
+		bezier_curve_unref(priv->curve);
+	}
+	priv->curve = curve;
+}
+
+
+/**
+ * gb_animation_add_target_property:
+ * @animation: (in): A #GbAnimation.
+ * @target: (in): A #GObject.
+ * @pspec: (in): A #ParamSpec of @target or a #GtkWidget<!-- -->'s parent.
+ * @value: (in): The new value for the property at the end of the animation.
+ *
+ * Adds a property of @target to the set of properties to be animated
+ * during the lifetime of the animation. @target does not need to be the
+ * target of @animation, so one animation can move many objects along
+ * the same timeline.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+gb_animation_add_target_property (GbAnimation  *animation,
+                                  gpointer      target,
+                                  GParamSpec   *pspec,
+                                  const GValue *value)
+{
+	GbAnimationPrivate *priv;
+	Tween tween = { 0 };
+	GType type;
+	gint i;
+
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+	g_return_if_fail(G_IS_OBJECT(target));
+	g_return_if_fail(pspec != NULL);
+	g_return_if_fail(value != NULL);
+	g_return_if_fail(value->g_type);
+	g_return_if_fail(!animation->priv->link.data);
+	g_return_if_fail(!animation->priv->hidden);
+
+	priv = animation->priv;
+
+	type = G_TYPE_FROM_INSTANCE(target);
+	tween.is_child = !g_type_is_a(type, pspec->owner_type);
+	if (tween.is_child) {
+		if (!GTK_IS_WIDGET(target)) {
+			g_critical("Cannot locate property %s in class %s",
+			           pspec->name, g_type_name(type));
+			return;
+		}
+	}
+
+	tween.target = g_object_ref(target);
+	tween.pspec = g_param_spec_ref(pspec);
+	g_value_init(&tween.begin, pspec->value_type);
+	g_value_init(&tween.end, pspec->value_type);
+	g_value_init(&tween.value, pspec->value_type);
+	g_value_copy(value, &tween.end);
+	gb_animation_resolve_setter(animation, &tween);
+	tween.slot = NO_SLOT;
+	g_array_append_val(priv->tweens, tween);
+
+	/*
+	 * Properties of a target are usually added together, so look for it
+	 * from the end.
+	 */
+	for (i = priv->targets->len - 1; i >= 0; i--) {
+		if (g_ptr_array_index(priv->targets, i) == target) {
+			return;
+		}
+	}
+	g_ptr_array_add(priv->targets, target);
+}
+
+
+/**
+ * gb_animation_add_property:
+ * @animation: (in): A #GbAnimation.
+ * @pspec: (in): A #ParamSpec of @target or a #GtkWidget<!-- -->'s parent.
+ * @value: (in): The new value for the property at the end of the animation.
  *
- * Updates the value of a property on an object using @value.
+ * Adds a new property to the set of properties to be animated during the
+ * lifetime of the animation.
  *
  * Returns: None.
- * Side effects: The property of @target is updated.
+ * Side effects: None.
  */
-static void
-gb_animation_update_property (GbAnimation *animation,
-                               gpointer      target,
-                               Tween        *tween,
-                               const GValue *value)
+void
+gb_animation_add_property (GbAnimation *animation,
+                            GParamSpec   *pspec,
+                            const GValue *value)
 {
-	g_object_set_property(target, tween->pspec->name, value);
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+	g_return_if_fail(animation->priv->target);
+
+	gb_animation_add_target_property(animation, animation->priv->target,
+	                                 pspec, value);
 }
 
 
 /**
- * gb_animation_update_child_property:
- * @animation: (in): A #GbAnimation.
+ * gb_animation_find_property:
  * @target: (in): A #GObject.
- * @tween: (in): A #Tween containing the property.
- * @value: (in): The new value for the property.
+ * @name: (in): The name of a property.
  *
- * Updates the value of the parent widget of the target to @value.
+ * Looks up the property @name of @target. If that does not exist and
+ * @target is a #GtkWidget, the child properties of its parent are
+ * looked at.
  *
- * Returns: None.
- * Side effects: The property of @target<!-- -->'s parent widget is updated.
+ * Returns: A #GParamSpec or %NULL if the property was not found.
+ * Side effects: A critical is logged if the property was not found.
  */
-static void
-gb_animation_update_child_property (GbAnimation *animation,
-                                     gpointer      target,
-                                     Tween        *tween,
-                                     const GValue *value)
+static GParamSpec *
+gb_animation_find_property (gpointer     target,
+                            const gchar *name)
 {
-	GtkWidget *parent = gtk_widget_get_parent(GTK_WIDGET(target));
-	gtk_container_child_set_property(GTK_CONTAINER(parent), target,
-	                                 tween->pspec->name, value);
+	GObjectClass *klass;
+	GObjectClass *pklass;
+	GParamSpec *pspec;
+	GtkWidget *parent;
+	GType type;
+	GType ptype;
+
+	type = G_TYPE_FROM_INSTANCE(target);
+	klass = G_OBJECT_GET_CLASS(target);
+
+	if (!(pspec = g_object_class_find_property(klass, name))) {
+		if (!g_type_is_a(type, GTK_TYPE_WIDGET)) {
+			g_critical("Failed to find property %s in %s",
+			           name, g_type_name(type));
+			return NULL;
+		}
+		if (!(parent = gtk_widget_get_parent(target))) {
+			g_critical("Failed to find property %s in %s",
+			           name, g_type_name(type));
+			return NULL;
+		}
+		pklass = G_OBJECT_GET_CLASS(parent);
+		ptype = G_TYPE_FROM_INSTANCE(parent);
+		if (!(pspec = gtk_container_class_find_child_property(pklass, name))) {
+			g_critical("Failed to find property %s in %s or parent %s",
+			           name, g_type_name(type), g_type_name(ptype));
+			return NULL;
+		}
+	}
+
+	return pspec;
 }
 
 
 /**
- * gb_animation_get_value_at_offset:
+ * gb_animation_add_valist:
  * @animation: (in): A #GbAnimation.
- * @offset: (in): The offset in the animation from 0.0 to 1.0.
- * @tween: (in): A #Tween containing the property.
- * @value: (out): A #GValue in which to store the property.
+ * @target: (in): A #GObject.
+ * @first_property: (in): The first property to animate.
+ * @args: (in): The end value of @first_property followed by more
+ *   property name and value pairs, terminated by %NULL.
  *
- * Retrieves a value for a particular position within the animation.
+ * Adds properties of @target to @animation in the manner of
+ * g_object_set_valist(). Properties not found on @target are looked up
+ * in the child properties of its parent widget.
  *
- * Returns: None.
+ * Returns: %TRUE if all the properties were added; otherwise %FALSE.
  * Side effects: None.
  */
-static void
-gb_animation_get_value_at_offset (GbAnimation *animation,
-                                   gdouble       offset,
-                                   Tween        *tween,
-                                   GValue       *value)
+gboolean
+gb_animation_add_valist (GbAnimation *animation,
+                         gpointer     target,
+                         const gchar *first_property,
+                         va_list      args)
 {
-	g_return_if_fail(GB_IS_ANIMATION(animation));
-	g_return_if_fail(offset >= 0.0);
-	g_return_if_fail(offset <= 1.0);
-	g_return_if_fail(tween != NULL);
-	g_return_if_fail(value != NULL);
-	g_return_if_fail(value->g_type == tween->pspec->value_type);
+	const gchar *name;
+	GParamSpec *pspec;
+	GValue value = { 0 };
+	gchar *error = NULL;
 
-	if (value->g_type < LAST_FUNDAMENTAL) {
-		/*
-		 * If you hit the following assertion, you need to add a function
-		 * to create the new value at the given offset.
-		 */
-		g_assert(tween_funcs[value->g_type]);
-		tween_funcs[value->g_type](&tween->begin, &tween->end, value, offset);
-	} else {
-		/*
-		 * TODO: Support complex transitions.
-		 */
-		if (offset >= 1.0) {
-			g_value_copy(&tween->end, value);
+	g_return_val_if_fail(GB_IS_ANIMATION(animation), FALSE);
+	g_return_val_if_fail(G_IS_OBJECT(target), FALSE);
+	g_return_val_if_fail(first_property != NULL, FALSE);
+
+	name = first_property;
+
+	do {
+		if (!(pspec = gb_animation_find_property(target, name))) {
+			return FALSE;
 		}
-	}
+
+		g_value_init(&value, pspec->value_type);
+		G_VALUE_COLLECT(&value, args, 0, &error);
+		if (error != NULL) {
+			g_critical("Failed to retrieve va_list value: %s", error);
+			g_value_unset(&value);
+			g_free(error);
+			return FALSE;
+		}
+
+		gb_animation_add_target_property(animation, target, pspec, &value);
+		g_value_unset(&value);
+	} while ((name = va_arg(args, const gchar *)));
+
+	return TRUE;
 }
 
 
 /**
- * gb_animation_tick:
+ * gb_animation_add_keyframe:
  * @animation: (in): A #GbAnimation.
+ * @target: (in): A #GObject.
+ * @property: (in): The name of a property of @target or of a child
+ *   property of its parent.
+ * @offset: (in): The position within the animation, 0.0 to 1.0.
+ * @mode: (in): The easing from the previous keyframe to this one.
+ * @value: (in): The value of @property at @offset.
  *
- * Moves the object properties to the next position in the animation.
+ * Makes @property of @target pass through @value at @offset, so that
+ * multi-step motion such as overshooting and settling runs as a single
+ * animation. Keyframes apply on top of the end value given with
+ * gb_animation_add_target_property(), which is reached at 1.0 with the
+ * mode of @animation. A property only animated by keyframes ends on
+ * the value of its last keyframe. Keyframes are ignored in
+ * %GB_ANIMATION_SPRING mode.
  *
- * Returns: %TRUE if the animation has not completed; otherwise %FALSE.
+ * Returns: None.
  * Side effects: None.
  */
-static gboolean
-gb_animation_tick (GbAnimation *animation)
+void
+gb_animation_add_keyframe (GbAnimation     *animation,
+                           gpointer         target,
+                           const gchar     *property,
+                           gdouble          offset,
+                           GbAnimationMode  mode,
+                           const GValue    *value)
 {
 	GbAnimationPrivate *priv;
-	GdkWindow *window;
-	gdouble offset;
-	gdouble alpha;
-	GValue value = { 0 };
-	Tween *tween;
+	Keyframe keyframe = { 0 };
+	Keyframe *slot;
+	GParamSpec *pspec;
+	Tween *tween = NULL;
+	guint lo;
+	guint hi;
+	guint mid;
 	gint i;
 
-	g_return_val_if_fail(GB_IS_ANIMATION(animation), FALSE);
+	g_return_if_fail(GB_IS_ANIMATION(animation));
+	g_return_if_fail(G_IS_OBJECT(target));
+	g_return_if_fail(property != NULL);
+	g_return_if_fail(offset >= 0.0 && offset <= 1.0);
+	g_return_if_fail(mode < GB_ANIMATION_LAST);
+	g_return_if_fail(value != NULL);
+	g_return_if_fail(!animation->priv->link.data);
+	g_return_if_fail(!animation->priv->hidden);
 
 	priv = animation->priv;
 
-	priv->frame_count++;
-	offset = gb_animation_get_offset(animation);
-	alpha = alpha_funcs[priv->mode](offset);
+	if (!(pspec = gb_animation_find_property(target, property))) {
+		return;
+	}
+	g_return_if_fail(G_VALUE_TYPE(value) == pspec->value_type);
 
-	/*
-	 * Update property values.
-	 */
-	for (i = 0; i < priv->tweens->len; i++) {
+	for (i = priv->tweens->len - 1; i >= 0; i--) {
 		tween = &g_array_index(priv->tweens, Tween, i);
-		g_value_init(&value, tween->pspec->value_type);
-		gb_animation_get_value_at_offset(animation, alpha, tween, &value);
-		if (!tween->is_child) {
-			gb_animation_update_property(animation, priv->target,
-			                              tween, &value);
-		} else {
-			gb_animation_update_child_property(animation, priv->target,
-			                                    tween, &value);
+		if (tween->target == target && tween->pspec == pspec) {
+			break;
 		}
-		g_value_unset(&value);
 	}
 
-	/*
-	 * Notify anyone interested in the tick signal.
-	 */
-	g_signal_emit(animation, signals[TICK], 0);
-
-	/*
-	 * Flush any outstanding events to the graphics server (in the case of X).
-	 */
-	if (GTK_IS_WIDGET(priv->target)) {
-		if ((window = gtk_widget_get_window(GTK_WIDGET(priv->target)))) {
-			gdk_window_flush(window);
-		}
+	if (i < 0) {
+		gb_animation_add_target_property(animation, target, pspec, value);
+		tween = &g_array_index(priv->tweens, Tween, priv->tweens->len - 1);
+		tween->keyed = TRUE;
 	}
 
-	return (offset < 1.0);
-}
+	if (!tween->keyframes) {
+		tween->keyframes = g_array_new(FALSE, FALSE, sizeof(Keyframe));
+	}
 
+	lo = 0;
+	hi = tween->keyframes->len;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (g_array_index(tween->keyframes, Keyframe, mid).offset < offset) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
 
-/**
- * gb_animation_timeout:
- * @data: (in): A #GbAnimation.
- *
- * Timeout from the main loop to move to the next step of the animation.
- *
- * Returns: %TRUE until the animation has completed; otherwise %FALSE.
- * Side effects: None.
- */
-static gboolean
-gb_animation_timeout (gpointer data)
-{
-	GbAnimation *animation = (GbAnimation *)data;
-	gboolean ret;
+	if (lo == tween->keyframes->len ||
+	    g_array_index(tween->keyframes, Keyframe, lo).offset != offset) {
+		keyframe.offset = offset;
+		g_array_insert_val(tween->keyframes, lo, keyframe);
+		slot = &g_array_index(tween->keyframes, Keyframe, lo);
+		g_value_init(&slot->value, pspec->value_type);
+	} else {
+		slot = &g_array_index(tween->keyframes, Keyframe, lo);
+	}
+	slot->mode = mode;
+	g_value_copy(value, &slot->value);
 
-	if (!(ret = gb_animation_tick(animation))) {
-		gb_animation_stop(animation);
+	if (tween->keyed && lo == tween->keyframes->len - 1) {
+		g_value_copy(value, &tween->end);
 	}
 
-	return ret;
+	if (mode == GB_ANIMATION_CUBIC_BEZIER && !priv->curve) {
+		priv->curve = bezier_curve_get(0.25, 0.1, 0.25, 1.0);
+	}
 }
 
 
 /**
- * gb_animation_start:
+ * gb_animation_clear_tweens:
  * @animation: (in): A #GbAnimation.
  *
- * Start the animation. When the animation stops, the internal reference will
- * be dropped and the animation may be finalized.
+ * Removes every tween from @animation, keeping the storage of the
+ * arrays holding them.
  *
  * Returns: None.
  * Side effects: None.
  */
-void
-gb_animation_start (GbAnimation *animation)
+static void
+gb_animation_clear_tweens (GbAnimation *animation)
 {
-	GbAnimationPrivate *priv;
-	GTimeVal now;
-
-	g_return_if_fail(GB_IS_ANIMATION(animation));
-	g_return_if_fail(!animation->priv->tween_handler);
-
-	priv = animation->priv;
+	GbAnimationPrivate *priv = animation->priv;
+	Tween *tween;
+	gint i;
 
-	g_get_current_time(&now);
-	g_object_ref_sink(animation);
-	gb_animation_load_begin_values(animation);
+	for (i = 0; i < priv->tweens->len; i++) {
+		tween = &g_array_index(priv->tweens, Tween, i);
+		g_value_unset(&tween->begin);
+		g_value_unset(&tween->end);
+		g_value_unset(&tween->value);
+		tween_clear_keyframes(tween);
+		g_param_spec_unref(tween->pspec);
+		g_object_unref(tween->target);
+	}
 
-	priv->begin_msec = TIMEVAL_TO_MSEC(now);
-	priv->tween_handler = gb_frame_source_add(priv->frame_rate,
-	                                           gb_animation_timeout,
-	                                           animation);
+	g_array_set_size(priv->tweens, 0);
+	g_ptr_array_set_size(priv->targets, 0);
 }
 
 
 /**
- * gb_animation_stop:
- * @animation: (in): A #GbAnimation.
+ * gb_animation_recycle:
+ * @animation: (in): A #GbAnimation losing its last reference.
  *
- * Stops a running animation. The internal reference to the animation is
- * dropped and therefore may cause the object to finalize.
+ * Resets @animation and adds it to the pool of animations reused by
+ * gb_object_animate(). The pool keeps the reference.
  *
  * Returns: None.
- * Side effects: None.
+ * Side effects: @animation is revived.
  */
-void
-gb_animation_stop (GbAnimation *animation)
+static void
+gb_animation_recycle (GbAnimation *animation)
 {
-	GbAnimationPrivate *priv;
+	GbAnimationPrivate *priv = animation->priv;
 
-	g_return_if_fail(GB_IS_ANIMATION(animation));
+	if (debug) {
+		gb_animation_dump_stats(animation);
+	}
 
-	priv = animation->priv;
+	gb_animation_clear_tweens(animation);
+
+	if (priv->curve) {
+		bezier_curve_unref(priv->curve);
+		priv->curve = NULL;
+	}
+
+	memset(&priv->stats, 0, sizeof priv->stats);
 
-   if (priv->tween_handler) {
-      g_source_remove(priv->tween_handler);
-      priv->tween_handler = 0;
-      gb_animation_unload_begin_values(animation);
-	   g_object_unref(animation);
-   }
+	priv->pool_next = gPool;
+	gPool = g_object_ref(animation);
+	gPoolSize++;
 }
 
 
 /**
- * gb_animation_add_property:
- * @animation: (in): A #GbAnimation.
- * @pspec: (in): A #ParamSpec of @target or a #GtkWidget<!-- -->'s parent.
- * @value: (in): The new value for the property at the end of the animation.
+ * gb_animation_new_pooled:
+ * @target: (in): A #GObject.
+ * @mode: (in): The animation mode.
+ * @duration_msec: (in): The duration in milliseconds.
+ * @frame_rate: (in): The frame-rate.
  *
- * Adds a new property to the set of properties to be animated during the
- * lifetime of the animation.
+ * Creates an animation for @target, reusing one from the pool if
+ * possible so that short-lived animations do not allocate. Like a new
+ * object, the animation has a floating reference.
  *
- * Returns: None.
+ * Returns: A #GbAnimation.
  * Side effects: None.
  */
-void
-gb_animation_add_property (GbAnimation *animation,
-                            GParamSpec   *pspec,
-                            const GValue *value)
+static GbAnimation *
+gb_animation_new_pooled (gpointer        target,
+                         GbAnimationMode mode,
+                         guint           duration_msec,
+                         gdouble         frame_rate)
 {
 	GbAnimationPrivate *priv;
-	Tween tween = { 0 };
-	GType type;
+	GbAnimation *animation;
 
-	g_return_if_fail(GB_IS_ANIMATION(animation));
-	g_return_if_fail(pspec != NULL);
-	g_return_if_fail(value != NULL);
-	g_return_if_fail(value->g_type);
-	g_return_if_fail(animation->priv->target);
-	g_return_if_fail(!animation->priv->tween_handler);
+	if (!(animation = gPool)) {
+		return g_object_new(GB_TYPE_ANIMATION,
+		                    "duration", duration_msec,
+		                    "frame-rate", frame_rate,
+		                    "mode", mode,
+		                    "target", target,
+		                    NULL);
+	}
 
 	priv = animation->priv;
+	gPool = priv->pool_next;
+	gPoolSize--;
 
-	type = G_TYPE_FROM_INSTANCE(priv->target);
-	tween.is_child = !g_type_is_a(type, pspec->owner_type);
-	if (tween.is_child) {
-		if (!GTK_IS_WIDGET(priv->target)) {
-			g_critical("Cannot locate property %s in class %s",
-			           pspec->name, g_type_name(type));
-			return;
-		}
-	}
+	priv->pool_next = NULL;
+	priv->target = target ? g_object_ref(target) : NULL;
+	priv->duration_msec = duration_msec;
+	priv->frame_rate = frame_rate;
+	priv->mode = mode;
+	priv->stiffness = 170.0;
+	priv->damping = 26.0;
+	priv->offset = 0.0;
+	priv->last_frame = 0;
+	g_object_force_floating(G_OBJECT(animation));
 
-	tween.pspec = g_param_spec_ref(pspec);
-	g_value_init(&tween.begin, pspec->value_type);
-	g_value_init(&tween.end, pspec->value_type);
-	g_value_copy(value, &tween.end);
-	g_array_append_val(priv->tweens, tween);
+	return animation;
 }
 
 
@@ -599,7 +3799,20 @@ gb_animation_dispose (GObject *object)
 		g_object_unref(instance);
 	}
 
+	gb_animation_set_widget(GB_ANIMATION(object), NULL);
+
 	G_OBJECT_CLASS(gb_animation_parent_class)->dispose(object);
+
+	/*
+	 * The parent class dropped the signal handlers and weak references,
+	 * so when the last reference goes away the animation can be reset
+	 * and kept for gb_object_animate() instead of being finalized.
+	 */
+	if (object->ref_count == 1 &&
+	    G_OBJECT_TYPE(object) == GB_TYPE_ANIMATION &&
+	    gPoolSize < POOL_MAX) {
+		gb_animation_recycle(GB_ANIMATION(object));
+	}
 }
 
 
@@ -616,21 +3829,18 @@ static void
 gb_animation_finalize (GObject *object)
 {
 	GbAnimationPrivate *priv = GB_ANIMATION(object)->priv;
-	Tween *tween;
-	gint i;
-
-	for (i = 0; i < priv->tweens->len; i++) {
-		tween = &g_array_index(priv->tweens, Tween, i);
-		g_value_unset(&tween->begin);
-		g_value_unset(&tween->end);
-		g_param_spec_unref(tween->pspec);
-	}
 
+	gb_animation_clear_tweens(GB_ANIMATION(object));
 	g_array_unref(priv->tweens);
+	g_ptr_array_unref(priv->targets);
+	g_ptr_array_unref(priv->watched);
+
+	if (priv->curve) {
+		bezier_curve_unref(priv->curve);
+	}
 
 	if (debug) {
-		g_print("Rendered %d frames in %d msec animation.\n",
-		        priv->frame_count, priv->duration_msec);
+		gb_animation_dump_stats(GB_ANIMATION(object));
 	}
 
 	G_OBJECT_CLASS(gb_animation_parent_class)->finalize(object);
@@ -658,12 +3868,18 @@ gb_animation_set_property (GObject      *object,
 	case PROP_DURATION:
 		animation->priv->duration_msec = g_value_get_uint(value);
 		break;
+	case PROP_DAMPING:
+		animation->priv->damping = g_value_get_double(value);
+		break;
 	case PROP_FRAME_RATE:
-		animation->priv->frame_rate = g_value_get_uint(value);
+		animation->priv->frame_rate = g_value_get_double(value);
 		break;
 	case PROP_MODE:
 		animation->priv->mode = g_value_get_enum(value);
 		break;
+	case PROP_STIFFNESS:
+		animation->priv->stiffness = g_value_get_double(value);
+		break;
 	case PROP_TARGET:
 		animation->priv->target = g_value_dup_object(value);
 		break;
@@ -724,13 +3940,33 @@ gb_animation_class_init (GbAnimationClass *klass)
 
 	g_object_class_install_property(object_class,
 	                                PROP_FRAME_RATE,
-	                                g_param_spec_uint("frame-rate",
-	                                                  "frame-rate",
-	                                                  "frame-rate",
-	                                                  1,
-	                                                  G_MAXUINT,
-	                                                  60,
-	                                                  G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
+	                                g_param_spec_double("frame-rate",
+	                                                    "frame-rate",
+	                                                    "The frame-rate when not synced to a frame clock",
+	                                                    1.0,
+	                                                    G_MAXDOUBLE,
+	                                                    60.0,
+	                                                    G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property(object_class,
+	                                PROP_STIFFNESS,
+	                                g_param_spec_double("stiffness",
+	                                                    "Stiffness",
+	                                                    "The spring constant in spring mode",
+	                                                    0.0,
+	                                                    G_MAXDOUBLE,
+	                                                    170.0,
+	                                                    G_PARAM_WRITABLE));
+
+	g_object_class_install_property(object_class,
+	                                PROP_DAMPING,
+	                                g_param_spec_double("damping",
+	                                                    "Damping",
+	                                                    "The damping coefficient in spring mode",
+	                                                    0.0,
+	                                                    G_MAXDOUBLE,
+	                                                    26.0,
+	                                                    G_PARAM_WRITABLE));
 
 	signals[TICK] = g_signal_new("tick",
 	                             GB_TYPE_ANIMATION,
@@ -742,6 +3978,22 @@ gb_animation_class_init (GbAnimationClass *klass)
 	                             G_TYPE_NONE,
 	                             0);
 
+	/**
+	 * GbAnimation::completed:
+	 *
+	 * Emitted when the animation ran to its end, after it was stopped.
+	 * It is not emitted for animations stopped with gb_animation_stop().
+	 */
+	signals[COMPLETED] = g_signal_new("completed",
+	                                  GB_TYPE_ANIMATION,
+	                                  G_SIGNAL_RUN_LAST,
+	                                  0,
+	                                  NULL,
+	                                  NULL,
+	                                  g_cclosure_marshal_VOID__VOID,
+	                                  G_TYPE_NONE,
+	                                  0);
+
 #define SET_ALPHA(_T, _t) \
 	alpha_funcs[GB_ANIMATION_##_T] = gb_animation_alpha_##_t
 
@@ -750,6 +4002,8 @@ gb_animation_class_init (GbAnimationClass *klass)
 	SET_ALPHA(EASE_OUT_QUAD, ease_out_quad);
 	SET_ALPHA(EASE_IN_OUT_QUAD, ease_in_out_quad);
 	SET_ALPHA(EASE_IN_CUBIC, ease_in_cubic);
+	SET_ALPHA(SPRING, linear); /* Springs are integrated instead */
+	SET_ALPHA(CUBIC_BEZIER, linear); /* Batches get eased offsets */
 
 #define SET_TWEEN(_T, _t) \
 	G_STMT_START { \
@@ -763,6 +4017,15 @@ gb_animation_class_init (GbAnimationClass *klass)
 	SET_TWEEN(ULONG, ulong);
 	SET_TWEEN(FLOAT, float);
 	SET_TWEEN(DOUBLE, double);
+
+	boxed_tween_funcs = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_insert(boxed_tween_funcs, GSIZE_TO_POINTER(GDK_TYPE_RGBA),
+	                    tween_rgba);
+	g_hash_table_insert(boxed_tween_funcs, GSIZE_TO_POINTER(GDK_TYPE_RECTANGLE),
+	                    tween_rectangle);
+	g_hash_table_insert(boxed_tween_funcs,
+	                    GSIZE_TO_POINTER(CAIRO_GOBJECT_TYPE_MATRIX),
+	                    tween_matrix);
 }
 
 
@@ -785,9 +4048,13 @@ gb_animation_init (GbAnimation *animation)
 	animation->priv = priv;
 
 	priv->duration_msec = 250;
-	priv->frame_rate = 60;
+	priv->frame_rate = 60.0;
+	priv->stiffness = 170.0;
+	priv->damping = 26.0;
 	priv->mode = GB_ANIMATION_LINEAR;
 	priv->tweens = g_array_new(FALSE, FALSE, sizeof(Tween));
+	priv->targets = g_ptr_array_new();
+	priv->watched = g_ptr_array_new_with_free_func(g_object_unref);
 }
 
 
@@ -809,6 +4076,8 @@ gb_animation_mode_get_type (void)
 		{ GB_ANIMATION_EASE_IN_OUT_QUAD, "GB_ANIMATION_EASE_IN_OUT_QUAD", "EASE_IN_OUT_QUAD" },
 		{ GB_ANIMATION_EASE_OUT_QUAD, "GB_ANIMATION_EASE_OUT_QUAD", "EASE_OUT_QUAD" },
 		{ GB_ANIMATION_EASE_IN_CUBIC, "GB_ANIMATION_EASE_IN_CUBIC", "EASE_IN_CUBIC" },
+		{ GB_ANIMATION_SPRING, "GB_ANIMATION_SPRING", "SPRING" },
+		{ GB_ANIMATION_CUBIC_BEZIER, "GB_ANIMATION_CUBIC_BEZIER", "CUBIC_BEZIER" },
 		{ 0 }
 	};
 
@@ -826,71 +4095,21 @@ GbAnimation*
 gb_object_animatev (gpointer          object,
                     GbAnimationMode  mode,
                     guint             duration_msec,
-                    guint             frame_rate,
+                    gdouble           frame_rate,
                     const gchar      *first_property,
                     va_list           args)
 {
 	GbAnimation *animation;
-	GObjectClass *klass;
-	GObjectClass *pklass;
-	const gchar *name;
-	GParamSpec *pspec;
-	GtkWidget *parent;
-	GValue value = { 0 };
-	gchar *error = NULL;
-	GType type;
-	GType ptype;
 
 	g_return_val_if_fail(first_property != NULL, NULL);
 	g_return_val_if_fail(mode < GB_ANIMATION_LAST, NULL);
 
-	name = first_property;
-	type = G_TYPE_FROM_INSTANCE(object);
-	klass = G_OBJECT_GET_CLASS(object);
-	animation = g_object_new(GB_TYPE_ANIMATION,
-	                         "duration", duration_msec,
-	                         "frame-rate", frame_rate ? frame_rate : 60,
-	                         "mode", mode,
-	                         "target", object,
-	                         NULL);
-
-	do {
-		/*
-		 * First check for the property on the object. If that does not exist
-		 * then check if the object has a parent and look at its child
-		 * properties (if its a GtkWidget).
-		 */
-		if (!(pspec = g_object_class_find_property(klass, name))) {
-			if (!g_type_is_a(type, GTK_TYPE_WIDGET)) {
-				g_critical("Failed to find property %s in %s",
-				           name, g_type_name(type));
-				goto failure;
-			}
-			if (!(parent = gtk_widget_get_parent(object))) {
-				g_critical("Failed to find property %s in %s",
-				           name, g_type_name(type));
-				goto failure;
-			}
-			pklass = G_OBJECT_GET_CLASS(parent);
-			ptype = G_TYPE_FROM_INSTANCE(parent);
-			if (!(pspec = gtk_container_class_find_child_property(pklass, name))) {
-				g_critical("Failed to find property %s in %s or parent %s",
-				           name, g_type_name(type), g_type_name(ptype));
-				goto failure;
-			}
-		}
-
-		g_value_init(&value, pspec->value_type);
-		G_VALUE_COLLECT(&value, args, 0, &error);
-		if (error != NULL) {
-			g_critical("Failed to retrieve va_list value: %s", error);
-			g_free(error);
-			goto failure;
-		}
+	animation = gb_animation_new_pooled(object, mode, duration_msec,
+	                                    frame_rate > 0.0 ? frame_rate : 60.0);
 
-		gb_animation_add_property(animation, pspec, &value);
-		g_value_unset(&value);
-	} while ((name = va_arg(args, const gchar *)));
+	if (!gb_animation_add_valist(animation, object, first_property, args)) {
+		goto failure;
+	}
 
 	gb_animation_start(animation);
 
@@ -927,7 +4146,7 @@ gb_object_animate (gpointer          object,
 	va_list args;
 
 	va_start(args, first_property);
-	animation = gb_object_animatev(object, mode, duration_msec, 0,
+	animation = gb_object_animatev(object, mode, duration_msec, 0.0,
 	                              first_property, args);
 	va_end(args);
 	return animation;
@@ -942,7 +4161,7 @@ GbAnimation*
 gb_object_animate_full (gpointer          object,
                         GbAnimationMode  mode,
                         guint             duration_msec,
-                        guint             frame_rate,
+                        gdouble           frame_rate,
                         GDestroyNotify    notify,
                         gpointer          notify_data,
                         const gchar      *first_property,
@@ -19,7 +19,7 @@
 #ifndef GB_ANIMATION_H
 #define GB_ANIMATION_H
 
-#include <glib-object.h>
+#include <gtk/gtk.h>
 
 G_BEGIN_DECLS
 
@@ -31,11 +31,19 @@ G_BEGIN_DECLS
 #define GB_IS_ANIMATION(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GB_TYPE_ANIMATION))
 #define GB_IS_ANIMATION_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  GB_TYPE_ANIMATION))
 #define GB_ANIMATION_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GB_TYPE_ANIMATION, GbAnimationClass))
+#define GB_ANIMATION_JITTER_BUCKETS  8
 
 typedef struct _GbAnimation        GbAnimation;
 typedef struct _GbAnimationClass   GbAnimationClass;
 typedef struct _GbAnimationPrivate GbAnimationPrivate;
 typedef enum   _GbAnimationMode    GbAnimationMode;
+typedef struct _GbAnimationStats   GbAnimationStats;
+
+typedef gint64 (*GbAnimationTimeFunc) (gpointer user_data);
+typedef void (*GbAnimationTweenFunc) (const GValue *begin,
+                                      const GValue *end,
+                                      GValue       *value,
+                                      gdouble       offset);
 
 enum _GbAnimationMode
 {
@@ -44,10 +52,27 @@ enum _GbAnimationMode
 	GB_ANIMATION_EASE_OUT_QUAD,
 	GB_ANIMATION_EASE_IN_OUT_QUAD,
 	GB_ANIMATION_EASE_IN_CUBIC,
+	GB_ANIMATION_SPRING,
+	GB_ANIMATION_CUBIC_BEZIER,
 
 	GB_ANIMATION_LAST
 };
 
+/*
+ * Frame statistics. jitter[] counts how far each frame landed from the
+ * target period: bucket 0 is under 0.25 msec and every bucket after it
+ * doubles the bound, the last one holding everything beyond.
+ */
+struct _GbAnimationStats
+{
+	guint   n_frames;     /* Frames ticked */
+	guint   n_missed;     /* Frames skipped at the target frame-rate */
+	guint   n_skipped;    /* Frames dropped by throttled clocks, globally */
+	guint64 tween_usec;   /* Time computing and setting values */
+	guint64 handler_usec; /* Time in notify and tick handlers */
+	guint   jitter[GB_ANIMATION_JITTER_BUCKETS];
+};
+
 struct _GbAnimation
 {
 	GInitiallyUnowned parent;
@@ -65,9 +90,44 @@ GType gb_animation_get_type         (void) G_GNUC_CONST;
 GType gb_animation_mode_get_type    (void) G_GNUC_CONST;
 void  gb_animation_start            (GbAnimation      *animation);
 void  gb_animation_stop             (GbAnimation      *animation);
+void  gb_animation_retarget         (GbAnimation      *animation,
+                                     const gchar      *first_property,
+                                     ...) G_GNUC_NULL_TERMINATED;
+void  gb_animation_set_widget       (GbAnimation      *animation,
+                                     GtkWidget        *widget);
+void  gb_animation_set_time_func    (GbAnimationTimeFunc func,
+                                     gpointer            user_data);
+void  gb_animation_run_frame        (void);
+void  gb_animation_get_stats         (GbAnimation      *animation,
+                                     GbAnimationStats *stats);
+void  gb_animation_reset_stats      (void);
+void  gb_animation_dump_stats       (GbAnimation      *animation);
+void  gb_animation_register_tween_func
+                                    (GType                type,
+                                     GbAnimationTweenFunc func);
+void  gb_animation_set_cubic_bezier (GbAnimation      *animation,
+                                     gdouble           x1,
+                                     gdouble           y1,
+                                     gdouble           x2,
+                                     gdouble           y2);
 void  gb_animation_add_property     (GbAnimation      *animation,
                                      GParamSpec       *pspec,
                                      const GValue     *value);
+void  gb_animation_add_target_property
+                                    (GbAnimation      *animation,
+                                     gpointer          target,
+                                     GParamSpec       *pspec,
+                                     const GValue     *value);
+void  gb_animation_add_keyframe     (GbAnimation      *animation,
+                                     gpointer          target,
+                                     const gchar      *property,
+                                     gdouble           offset,
+                                     GbAnimationMode   mode,
+                                     const GValue     *value);
+gboolean gb_animation_add_valist    (GbAnimation      *animation,
+                                     gpointer          target,
+                                     const gchar      *first_property,
+                                     va_list           args);
 GbAnimation* gb_object_animate      (gpointer          object,
                                      GbAnimationMode   mode,
                                      guint             duration_msec,
@@ -76,7 +136,7 @@ GbAnimation* gb_object_animate      (gpointer          object,
 GbAnimation* gb_object_animate_full (gpointer          object,
                                      GbAnimationMode   mode,
                                      guint             duration_msec,
-                                     guint             frame_rate,
+                                     gdouble           frame_rate,
                                      GDestroyNotify    notify,
                                      gpointer          notify_data,
                                      const gchar      *first_property,
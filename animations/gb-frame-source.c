@@ -32,6 +32,15 @@
 #include "gb-frame-source.h"
 #include "gb-timeout-interval.h"
 
+/* On Linux, frames are woken up by a timerfd armed with the absolute
+   deadline of the next frame rather than by the poll timeout, which
+   only has millisecond resolution. */
+#if defined (__linux__) && GLIB_CHECK_VERSION (2, 36, 0)
+#define GB_FRAME_SOURCE_TIMERFD 1
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
 typedef struct _GbFrameSource GbFrameSource;
 
 struct _GbFrameSource
@@ -39,6 +48,12 @@ struct _GbFrameSource
   GSource source;
 
   GbTimeoutInterval timeout;
+
+#ifdef GB_FRAME_SOURCE_TIMERFD
+  gint timer_fd;       /* -1 if the timerfd could not be created */
+  gpointer timer_tag;
+  gint64 armed;        /* deadline the timer is armed for, or 0 */
+#endif
 };
 
 static gboolean gb_frame_source_prepare  (GSource     *source,
@@ -47,20 +62,64 @@ static gboolean gb_frame_source_check    (GSource     *source);
 static gboolean gb_frame_source_dispatch (GSource     *source,
                                                GSourceFunc  callback,
                                                gpointer     user_data);
+static void     gb_frame_source_finalize (GSource     *source);
 
 static GSourceFuncs gb_frame_source_funcs =
 {
   gb_frame_source_prepare,
   gb_frame_source_check,
   gb_frame_source_dispatch,
-  NULL
+  gb_frame_source_finalize
 };
 
+static GbFrameSourceTimeFunc gb_frame_source_time_func = NULL;
+static gpointer gb_frame_source_time_data = NULL;
+
+/**
+ * gb_frame_source_set_time_func:
+ * @func: (allow-none): function returning the current monotonic time in
+ *   microseconds, or %NULL to use the time of the main loop
+ * @user_data: data to pass to @func
+ *
+ * Replaces the clock that frame sources are timed against. Test
+ * harnesses and benchmarks can install a virtual clock they advance
+ * by hand so that frames are due at reproducible times regardless of
+ * how long they take to run.
+ */
+void
+gb_frame_source_set_time_func (GbFrameSourceTimeFunc func,
+                               gpointer              user_data)
+{
+  gb_frame_source_time_func = func;
+  gb_frame_source_time_data = user_data;
+}
+
+/**
+ * gb_frame_source_get_time:
+ * @source: (allow-none): the #GSource being dispatched, or %NULL
+ *
+ * Gets the current time of the clock frame sources are timed against.
+ * Without a function installed with gb_frame_source_set_time_func()
+ * this is the cached time of @source or, if @source is %NULL, the
+ * monotonic time.
+ *
+ * Return value: the monotonic time in microseconds.
+ */
+gint64
+gb_frame_source_get_time (GSource *source)
+{
+  if (gb_frame_source_time_func)
+    return gb_frame_source_time_func (gb_frame_source_time_data);
+
+  return source ? g_source_get_time (source) : g_get_monotonic_time ();
+}
+
 /**
  * gb_frame_source_add_full:
  * @priority: the priority of the frame source. Typically this will be in the
  *   range between %G_PRIORITY_DEFAULT and %G_PRIORITY_HIGH.
- * @fps: the number of times per second to call the function
+ * @fps: the number of times per second to call the function. Fractional
+ *   rates such as 59.94 are honoured.
  * @func: function to call
  * @data: data to pass to the function
  * @notify: function to call when the timeout source is removed
@@ -82,13 +141,16 @@ static GSourceFuncs gb_frame_source_funcs =
  * multiple times to catch up missing frames if @func takes more than
  * @interval ms to execute.
  *
+ * On Linux the source is woken up by a timerfd at the exact time the
+ * next frame is due instead of at the next whole millisecond.
+ *
  * Return value: the ID (greater than 0) of the event source.
  *
  * Since: 0.8
  */
 guint
 gb_frame_source_add_full (gint           priority,
-                           guint          fps,
+                           gdouble        fps,
                            GSourceFunc    func,
                            gpointer       data,
                            GDestroyNotify notify)
@@ -98,7 +160,19 @@ gb_frame_source_add_full (gint           priority,
                                   sizeof (GbFrameSource));
   GbFrameSource *frame_source = (GbFrameSource *) source;
 
-  _gb_timeout_interval_init (&frame_source->timeout, fps);
+  _gb_timeout_interval_init (&frame_source->timeout, fps,
+                             gb_frame_source_get_time (NULL));
+
+#ifdef GB_FRAME_SOURCE_TIMERFD
+  frame_source->timer_fd = timerfd_create (CLOCK_MONOTONIC,
+                                           TFD_CLOEXEC | TFD_NONBLOCK);
+  frame_source->timer_tag = NULL;
+  frame_source->armed = 0;
+  if (frame_source->timer_fd >= 0)
+    frame_source->timer_tag = g_source_add_unix_fd (source,
+                                                    frame_source->timer_fd,
+                                                    G_IO_IN);
+#endif
 
   if (priority != G_PRIORITY_DEFAULT)
     g_source_set_priority (source, priority);
@@ -129,30 +203,84 @@ gb_frame_source_add_full (gint           priority,
  * Since: 0.8
  */
 guint
-gb_frame_source_add (guint       fps,
+gb_frame_source_add (gdouble     fps,
                       GSourceFunc func,
                       gpointer    data)
 {
   return gb_frame_source_add_full (G_PRIORITY_DEFAULT, fps, func, data, NULL);
 }
 
+#ifdef GB_FRAME_SOURCE_TIMERFD
+/* Arms the timerfd for the next frame. Deadlines are only known in
+   monotonic time, so a clock installed with
+   gb_frame_source_set_time_func() falls back to the poll timeout. */
+static gboolean
+gb_frame_source_arm_timer (GbFrameSource *frame_source)
+{
+  struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+  gint64 deadline;
+
+  if (frame_source->timer_fd < 0 || gb_frame_source_time_func)
+    return FALSE;
+
+  /* A microsecond late so that the frame is due when the timer fires
+     despite the rounding of frame times */
+  deadline = _gb_timeout_interval_get_expiration (&frame_source->timeout) + 1;
+
+  if (deadline == frame_source->armed)
+    return TRUE;
+
+  spec.it_value.tv_sec = deadline / G_USEC_PER_SEC;
+  spec.it_value.tv_nsec = (deadline % G_USEC_PER_SEC) * 1000;
+
+  if (timerfd_settime (frame_source->timer_fd, TFD_TIMER_ABSTIME,
+                       &spec, NULL) < 0)
+    return FALSE;
+
+  frame_source->armed = deadline;
+
+  return TRUE;
+}
+#endif
+
 static gboolean
 gb_frame_source_prepare (GSource *source,
                           gint    *delay)
 {
   GbFrameSource *frame_source = (GbFrameSource *) source;
-  GTimeVal current_time;
+  gboolean ready;
 
-  g_source_get_current_time (source, &current_time);
-
-  return _gb_timeout_interval_prepare (&current_time,
+  ready = _gb_timeout_interval_prepare (gb_frame_source_get_time (source),
                                         &frame_source->timeout,
                                         delay);
+
+#ifdef GB_FRAME_SOURCE_TIMERFD
+  if (!ready && delay && gb_frame_source_arm_timer (frame_source))
+    *delay = -1;
+#endif
+
+  return ready;
 }
 
 static gboolean
 gb_frame_source_check (GSource *source)
 {
+#ifdef GB_FRAME_SOURCE_TIMERFD
+  GbFrameSource *frame_source = (GbFrameSource *) source;
+  guint64 expirations;
+
+  if (frame_source->timer_tag &&
+      (g_source_query_unix_fd (source, frame_source->timer_tag) & G_IO_IN))
+    {
+      /* The timer is one-shot; reading clears the fd */
+      if (read (frame_source->timer_fd, &expirations,
+                sizeof expirations) < 0)
+        expirations = 0;
+
+      frame_source->armed = 0;
+    }
+#endif
+
   return gb_frame_source_prepare (source, NULL);
 }
 
@@ -166,3 +294,14 @@ gb_frame_source_dispatch (GSource     *source,
   return _gb_timeout_interval_dispatch (&frame_source->timeout,
                                          callback, user_data);
 }
+
+static void
+gb_frame_source_finalize (GSource *source)
+{
+#ifdef GB_FRAME_SOURCE_TIMERFD
+  GbFrameSource *frame_source = (GbFrameSource *) source;
+
+  if (frame_source->timer_fd >= 0)
+    close (frame_source->timer_fd);
+#endif
+}
@@ -28,16 +28,23 @@
 
 G_BEGIN_DECLS
 
-guint gb_frame_source_add (guint       fps,
+typedef gint64 (*GbFrameSourceTimeFunc) (gpointer user_data);
+
+guint gb_frame_source_add (gdouble     fps,
                             GSourceFunc func,
                             gpointer    data);
 
 guint gb_frame_source_add_full (gint           priority,
-                                 guint          fps,
+                                 gdouble        fps,
                                  GSourceFunc    func,
                                  gpointer       data,
                                  GDestroyNotify notify);
 
+void gb_frame_source_set_time_func (GbFrameSourceTimeFunc func,
+                                    gpointer              user_data);
+
+gint64 gb_frame_source_get_time (GSource *source);
+
 G_END_DECLS
 
 #endif /* __GB_FRAME_SOURCE_H__ */
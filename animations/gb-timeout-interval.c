@@ -32,47 +32,47 @@
 
 void
 _gb_timeout_interval_init (GbTimeoutInterval *interval,
-                            guint                   fps)
+                            gdouble                 fps,
+                            gint64                  current_time)
 {
-  g_get_current_time (&interval->start_time);
+  interval->start_time = current_time;
   interval->fps = fps;
   interval->frame_count = 0;
 }
 
-static guint
-_gb_timeout_interval_get_ticks (const GTimeVal         *current_time,
-                                     GbTimeoutInterval *interval)
+/* Times are kept in microseconds of the monotonic clock so that wall
+   clock adjustments don't make the interval jump and so that
+   fractional rates such as 59.94 fps don't accumulate rounding
+   errors. */
+static gint64
+_gb_timeout_interval_get_frame_time (const GbTimeoutInterval *interval,
+                                     guint                    frame_num)
 {
-  return ((current_time->tv_sec - interval->start_time.tv_sec) * 1000
-        + (current_time->tv_usec - interval->start_time.tv_usec) / 1000);
+  return (gint64) (frame_num * (G_USEC_PER_SEC / interval->fps));
 }
 
 gboolean
-_gb_timeout_interval_prepare (const GTimeVal         *current_time,
+_gb_timeout_interval_prepare (gint64                  current_time,
                                GbTimeoutInterval *interval,
                                gint                   *delay)
 {
-  guint elapsed_time, new_frame_num;
+  gint64 elapsed_time;
+  guint new_frame_num;
 
-  elapsed_time = _gb_timeout_interval_get_ticks (current_time,
-                                                      interval);
-  new_frame_num = elapsed_time * interval->fps
-                / 1000;
+  elapsed_time = current_time - interval->start_time;
+  new_frame_num = (elapsed_time < 0 ? 0
+                   : (guint) (elapsed_time * interval->fps / G_USEC_PER_SEC));
 
   /* If time has gone backwards or the time since the last frame is
      greater than the two frames worth then reset the time and do a
      frame now */
-  if (new_frame_num < interval->frame_count ||
+  if (elapsed_time < 0 ||
+      new_frame_num < interval->frame_count ||
       new_frame_num - interval->frame_count > 2)
     {
-      /* Get the frame time rounded up to the nearest ms */
-      guint frame_time = (1000 + interval->fps - 1) / interval->fps;
-
-      /* Reset the start time */
-      interval->start_time = *current_time;
-
-      /* Move the start time as if one whole frame has elapsed */
-      g_time_val_add (&interval->start_time, -(gint) frame_time * 1000);
+      /* Reset the start time as if one whole frame has elapsed */
+      interval->start_time = (current_time
+                              - _gb_timeout_interval_get_frame_time (interval, 1));
 
       interval->frame_count = 0;
 
@@ -90,9 +90,12 @@ _gb_timeout_interval_prepare (const GTimeVal         *current_time,
     }
   else
     {
+      /* Round the delay up to the next ms so we don't wake up just
+         before the frame is due */
       if (delay)
-	*delay = ((interval->frame_count + 1) * 1000 / interval->fps
-               - elapsed_time);
+	*delay = (gint) ((_gb_timeout_interval_get_frame_time (interval,
+                                                               interval->frame_count + 1)
+                          - elapsed_time + 999) / 1000);
 
       return FALSE;
     }
@@ -113,22 +116,27 @@ _gb_timeout_interval_dispatch (GbTimeoutInterval *interval,
   return FALSE;
 }
 
+/* Returns the monotonic time in microseconds at which the next frame
+   is due. */
+gint64
+_gb_timeout_interval_get_expiration (const GbTimeoutInterval *interval)
+{
+  return (interval->start_time
+          + _gb_timeout_interval_get_frame_time (interval,
+                                                 interval->frame_count + 1));
+}
+
 gint
 _gb_timeout_interval_compare_expiration (const GbTimeoutInterval *a,
                                           const GbTimeoutInterval *b)
 {
-  guint a_delay = 1000 / a->fps;
-  guint b_delay = 1000 / b->fps;
-  glong b_difference;
-  gint comparison;
-
-  b_difference = ((a->start_time.tv_sec - b->start_time.tv_sec) * 1000
-               + (a->start_time.tv_usec - b->start_time.tv_usec) / 1000);
+  gint64 a_expiration;
+  gint64 b_expiration;
 
-  comparison = ((gint) ((a->frame_count + 1) * a_delay)
-             - (gint) ((b->frame_count + 1) * b_delay + b_difference));
+  a_expiration = _gb_timeout_interval_get_expiration (a);
+  b_expiration = _gb_timeout_interval_get_expiration (b);
 
-  return (comparison < 0 ? -1
-                         : comparison > 0 ? 1
-                                          : 0);
+  return (a_expiration < b_expiration ? -1
+                                      : a_expiration > b_expiration ? 1
+                                                                    : 0);
 }
@@ -32,14 +32,16 @@ typedef struct _GbTimeoutInterval GbTimeoutInterval;
 
 struct _GbTimeoutInterval
 {
-  GTimeVal start_time;
-  guint frame_count, fps;
+  gint64 start_time;   /* monotonic, in microseconds */
+  guint frame_count;
+  gdouble fps;
 };
 
 void _gb_timeout_interval_init (GbTimeoutInterval *interval,
-                                 guint fps);
+                                 gdouble fps,
+                                 gint64 current_time);
 
-gboolean _gb_timeout_interval_prepare (const GTimeVal *current_time,
+gboolean _gb_timeout_interval_prepare (gint64 current_time,
                                         GbTimeoutInterval *interval,
                                         gint *delay);
 
@@ -47,6 +49,8 @@ gboolean _gb_timeout_interval_dispatch (GbTimeoutInterval *interval,
                                          GSourceFunc     callback,
                                          gpointer        user_data);
 
+gint64 _gb_timeout_interval_get_expiration (const GbTimeoutInterval *interval);
+
 gint _gb_timeout_interval_compare_expiration (const GbTimeoutInterval *a,
                                                const GbTimeoutInterval *b);
 
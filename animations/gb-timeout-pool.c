@@ -0,0 +1,407 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * Authored By Emmanuele Bassi  <ebassi@openedhand.com>
+ *
+ * Copyright (C) 2006 OpenedHand
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Reworked for Gb: the timeouts are kept in a binary heap ordered by
+   their next expiration instead of a sorted list. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gb-frame-source.h"
+#include "gb-timeout-interval.h"
+#include "gb-timeout-pool.h"
+
+#define NOT_QUEUED G_MAXUINT
+
+typedef struct _GbTimeout GbTimeout;
+
+struct _GbTimeout
+{
+  guint id;
+  guint index;        /* position in the heap, or NOT_QUEUED */
+
+  GbTimeoutInterval interval;
+
+  GSourceFunc func;   /* NULL once removed while being dispatched */
+  gpointer data;
+  GDestroyNotify notify;
+};
+
+struct _GbTimeoutPool
+{
+  GSource source;
+
+  guint next_id;
+
+  GHashTable *timeouts;   /* id -> GbTimeout */
+  GPtrArray *heap;        /* queued GbTimeouts, soonest first */
+  GPtrArray *due;         /* GbTimeouts being dispatched */
+};
+
+static gboolean gb_timeout_pool_prepare  (GSource     *source,
+                                          gint        *next_timeout);
+static gboolean gb_timeout_pool_check    (GSource     *source);
+static gboolean gb_timeout_pool_dispatch (GSource     *source,
+                                          GSourceFunc  callback,
+                                          gpointer     data);
+static void     gb_timeout_pool_finalize (GSource     *source);
+
+static GSourceFuncs gb_timeout_pool_funcs =
+{
+  gb_timeout_pool_prepare,
+  gb_timeout_pool_check,
+  gb_timeout_pool_dispatch,
+  gb_timeout_pool_finalize
+};
+
+#define HEAP_GET(pool,i) ((GbTimeout *) g_ptr_array_index ((pool)->heap, (i)))
+
+static void
+gb_timeout_free (GbTimeout *timeout)
+{
+  if (timeout->notify)
+    timeout->notify (timeout->data);
+
+  g_slice_free (GbTimeout, timeout);
+}
+
+static inline void
+gb_timeout_pool_heap_set (GbTimeoutPool *pool,
+                          guint          index,
+                          GbTimeout     *timeout)
+{
+  g_ptr_array_index (pool->heap, index) = timeout;
+  timeout->index = index;
+}
+
+static void
+gb_timeout_pool_sift_up (GbTimeoutPool *pool,
+                         guint          index)
+{
+  GbTimeout *timeout = HEAP_GET (pool, index);
+  guint parent;
+
+  while (index > 0)
+    {
+      parent = (index - 1) / 2;
+
+      if (_gb_timeout_interval_compare_expiration (&HEAP_GET (pool, parent)->interval,
+                                                   &timeout->interval) <= 0)
+        break;
+
+      gb_timeout_pool_heap_set (pool, index, HEAP_GET (pool, parent));
+      index = parent;
+    }
+
+  gb_timeout_pool_heap_set (pool, index, timeout);
+}
+
+static void
+gb_timeout_pool_sift_down (GbTimeoutPool *pool,
+                           guint          index)
+{
+  GbTimeout *timeout = HEAP_GET (pool, index);
+  guint len = pool->heap->len;
+  guint child;
+
+  while ((child = 2 * index + 1) < len)
+    {
+      if (child + 1 < len &&
+          _gb_timeout_interval_compare_expiration (&HEAP_GET (pool, child + 1)->interval,
+                                                   &HEAP_GET (pool, child)->interval) < 0)
+        child++;
+
+      if (_gb_timeout_interval_compare_expiration (&timeout->interval,
+                                                   &HEAP_GET (pool, child)->interval) <= 0)
+        break;
+
+      gb_timeout_pool_heap_set (pool, index, HEAP_GET (pool, child));
+      index = child;
+    }
+
+  gb_timeout_pool_heap_set (pool, index, timeout);
+}
+
+static void
+gb_timeout_pool_heap_push (GbTimeoutPool *pool,
+                           GbTimeout     *timeout)
+{
+  g_ptr_array_add (pool->heap, timeout);
+  timeout->index = pool->heap->len - 1;
+  gb_timeout_pool_sift_up (pool, timeout->index);
+}
+
+static void
+gb_timeout_pool_heap_remove (GbTimeoutPool *pool,
+                             GbTimeout     *timeout)
+{
+  guint index = timeout->index;
+  GbTimeout *last;
+
+  last = g_ptr_array_remove_index (pool->heap, pool->heap->len - 1);
+  timeout->index = NOT_QUEUED;
+
+  if (last == timeout)
+    return;
+
+  gb_timeout_pool_heap_set (pool, index, last);
+  gb_timeout_pool_sift_up (pool, index);
+  gb_timeout_pool_sift_down (pool, last->index);
+}
+
+static gboolean
+gb_timeout_pool_prepare (GSource *source,
+                         gint    *next_timeout)
+{
+  GbTimeoutPool *pool = (GbTimeoutPool *) source;
+  gboolean ready;
+
+  if (pool->heap->len == 0)
+    {
+      if (next_timeout)
+        *next_timeout = -1;
+
+      return FALSE;
+    }
+
+  /* Only the soonest timeout matters. Preparing it may reset its
+     interval if the clock jumped, so put it back in its place. */
+  ready = _gb_timeout_interval_prepare (gb_frame_source_get_time (source),
+                                        &HEAP_GET (pool, 0)->interval,
+                                        next_timeout);
+  gb_timeout_pool_sift_down (pool, 0);
+
+  return ready;
+}
+
+static gboolean
+gb_timeout_pool_check (GSource *source)
+{
+  return gb_timeout_pool_prepare (source, NULL);
+}
+
+static gboolean
+gb_timeout_pool_dispatch (GSource     *source,
+                          GSourceFunc  callback,
+                          gpointer     data)
+{
+  GbTimeoutPool *pool = (GbTimeoutPool *) source;
+  gint64 now = gb_frame_source_get_time (source);
+  GbTimeout *timeout;
+  guint i;
+
+  /* Take every timeout that is due off the heap before calling any of
+     them, so that callbacks are free to add and remove timeouts. */
+  while (pool->heap->len > 0 &&
+         _gb_timeout_interval_prepare (now, &HEAP_GET (pool, 0)->interval,
+                                       NULL))
+    {
+      timeout = HEAP_GET (pool, 0);
+      gb_timeout_pool_heap_remove (pool, timeout);
+      g_ptr_array_add (pool->due, timeout);
+    }
+
+  for (i = 0; i < pool->due->len; i++)
+    {
+      timeout = g_ptr_array_index (pool->due, i);
+
+      if (timeout->func &&
+          _gb_timeout_interval_dispatch (&timeout->interval,
+                                         timeout->func, timeout->data))
+        {
+          /* The callback may have removed its own timeout. */
+          if (timeout->func)
+            {
+              gb_timeout_pool_heap_push (pool, timeout);
+              continue;
+            }
+        }
+      else if (timeout->func)
+        g_hash_table_remove (pool->timeouts, GUINT_TO_POINTER (timeout->id));
+
+      gb_timeout_free (timeout);
+    }
+
+  g_ptr_array_set_size (pool->due, 0);
+
+  return TRUE;
+}
+
+static void
+gb_timeout_pool_finalize (GSource *source)
+{
+  GbTimeoutPool *pool = (GbTimeoutPool *) source;
+  GHashTableIter iter;
+  gpointer timeout;
+
+  g_hash_table_iter_init (&iter, pool->timeouts);
+  while (g_hash_table_iter_next (&iter, NULL, &timeout))
+    gb_timeout_free (timeout);
+
+  g_hash_table_unref (pool->timeouts);
+  g_ptr_array_unref (pool->heap);
+  g_ptr_array_unref (pool->due);
+}
+
+/**
+ * gb_timeout_pool_new:
+ * @priority: the priority of the timeout pool. Typically this will
+ *   be #G_PRIORITY_DEFAULT
+ *
+ * Creates a new timeout pool source. A timeout pool should be used when
+ * multiple timeout functions, running at the same priority, are needed
+ * and the g_timeout_add() API might lead to starvation of the time slice
+ * of the main loop, or when many frame sources would each have to be
+ * prepared and checked on every iteration. A timeout pool is a single
+ * source whatever the number of timeouts it holds: it wakes up for the
+ * soonest one and then dispatches every timeout that is due.
+ *
+ * The pool is attached to the default main context.
+ *
+ * Return value: the newly created #GbTimeoutPool. The pool should be
+ *   destroyed with gb_timeout_pool_destroy().
+ */
+GbTimeoutPool *
+gb_timeout_pool_new (gint priority)
+{
+  GSource *source = g_source_new (&gb_timeout_pool_funcs,
+                                  sizeof (GbTimeoutPool));
+  GbTimeoutPool *pool = (GbTimeoutPool *) source;
+
+  if (priority != G_PRIORITY_DEFAULT)
+    g_source_set_priority (source, priority);
+
+#if GLIB_CHECK_VERSION (2, 25, 8)
+  g_source_set_name (source, "Gb timeout pool");
+#endif
+
+  pool->next_id = 1;
+  pool->timeouts = g_hash_table_new (g_direct_hash, g_direct_equal);
+  pool->heap = g_ptr_array_new ();
+  pool->due = g_ptr_array_new ();
+
+  g_source_attach (source, NULL);
+
+  return pool;
+}
+
+/**
+ * gb_timeout_pool_destroy:
+ * @pool: a #GbTimeoutPool
+ *
+ * Removes @pool from the main loop and frees it. The notify function
+ * of every timeout still in the pool is called.
+ */
+void
+gb_timeout_pool_destroy (GbTimeoutPool *pool)
+{
+  g_return_if_fail (pool != NULL);
+
+  g_source_destroy ((GSource *) pool);
+  g_source_unref ((GSource *) pool);
+}
+
+/**
+ * gb_timeout_pool_add:
+ * @pool: a #GbTimeoutPool
+ * @fps: the time between calls to the function, in frames per second
+ * @func: function to call
+ * @data: data to pass to the function, or %NULL
+ * @notify: function to call when the timeout is removed, or %NULL
+ *
+ * Sets a function to be called at regular intervals, and puts it inside
+ * the @pool. The function is repeatedly called until it returns %FALSE,
+ * at which point the timeout is automatically destroyed and the function
+ * won't be called again. If @notify is not %NULL, the @notify function
+ * will be called. The first call to @func will be at the end of the
+ * first interval. Like gb_frame_source_add(), the timeout compensates
+ * for the time @func takes to run.
+ *
+ * Return value: the ID (greater than 0) of the timeout inside the pool.
+ *   Use gb_timeout_pool_remove() to stop the timeout.
+ */
+guint
+gb_timeout_pool_add (GbTimeoutPool *pool,
+                     gdouble        fps,
+                     GSourceFunc    func,
+                     gpointer       data,
+                     GDestroyNotify notify)
+{
+  GbTimeout *timeout;
+
+  g_return_val_if_fail (pool != NULL, 0);
+  g_return_val_if_fail (fps > 0, 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  timeout = g_slice_new (GbTimeout);
+  timeout->func = func;
+  timeout->data = data;
+  timeout->notify = notify;
+  _gb_timeout_interval_init (&timeout->interval, fps,
+                             gb_frame_source_get_time (NULL));
+
+  do
+    timeout->id = pool->next_id++;
+  while (timeout->id == 0 ||
+         g_hash_table_lookup (pool->timeouts, GUINT_TO_POINTER (timeout->id)));
+
+  g_hash_table_insert (pool->timeouts, GUINT_TO_POINTER (timeout->id),
+                       timeout);
+  gb_timeout_pool_heap_push (pool, timeout);
+
+  return timeout->id;
+}
+
+/**
+ * gb_timeout_pool_remove:
+ * @pool: a #GbTimeoutPool
+ * @id: the id of the timeout to remove
+ *
+ * Removes a timeout function with @id from the timeout pool. The id
+ * is the same returned when adding a function to the timeout pool with
+ * gb_timeout_pool_add(). A timeout may remove itself, or any other,
+ * from within its function.
+ */
+void
+gb_timeout_pool_remove (GbTimeoutPool *pool,
+                        guint          id)
+{
+  GbTimeout *timeout;
+
+  g_return_if_fail (pool != NULL);
+
+  timeout = g_hash_table_lookup (pool->timeouts, GUINT_TO_POINTER (id));
+  g_return_if_fail (timeout != NULL);
+
+  g_hash_table_remove (pool->timeouts, GUINT_TO_POINTER (id));
+
+  if (timeout->index != NOT_QUEUED)
+    {
+      gb_timeout_pool_heap_remove (pool, timeout);
+      gb_timeout_free (timeout);
+    }
+  else
+    /* Being dispatched; freed once its turn comes. */
+    timeout->func = NULL;
+}
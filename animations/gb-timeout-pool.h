@@ -3,9 +3,9 @@
  *
  * An OpenGL based 'interactive canvas' library.
  *
- * Authored By Matthew Allum  <mallum@openedhand.com>
+ * Authored By Emmanuele Bassi  <ebassi@openedhand.com>
  *
- * Copyright (C) 2008 OpenedHand
+ * Copyright (C) 2006 OpenedHand
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
@@ -21,23 +21,28 @@
  * License along with this library. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#ifndef __GB_FRAME_SOURCE_H__
-#define __GB_FRAME_SOURCE_H__
+#ifndef __GB_TIMEOUT_POOL_H__
+#define __GB_TIMEOUT_POOL_H__
 
 #include <glib.h>
 
 G_BEGIN_DECLS
 
-guint gb_frame_source_add (guint       fps,
-                            GSourceFunc func,
-                            gpointer    data);
+typedef struct _GbTimeoutPool GbTimeoutPool;
 
-guint gb_frame_source_add_full (gint           priority,
-                                 guint          fps,
-                                 GSourceFunc    func,
-                                 gpointer       data,
-                                 GDestroyNotify notify);
+GbTimeoutPool *gb_timeout_pool_new     (gint           priority);
+
+void           gb_timeout_pool_destroy (GbTimeoutPool *pool);
+
+guint          gb_timeout_pool_add     (GbTimeoutPool *pool,
+                                        gdouble        fps,
+                                        GSourceFunc    func,
+                                        gpointer       data,
+                                        GDestroyNotify notify);
+
+void           gb_timeout_pool_remove  (GbTimeoutPool *pool,
+                                        guint          id);
 
 G_END_DECLS
 
-#endif /* __GB_FRAME_SOURCE_H__ */
+#endif /* __GB_TIMEOUT_POOL_H__ */
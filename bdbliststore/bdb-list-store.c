@@ -1,16 +1,23 @@
 #include "bdb-list-store.h"
 
 #include <glib.h>
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <zstd.h>
+#include <zdict.h>
 
 #define CLEAR_DBT(dbt)   (memset(&(dbt), 0, sizeof(dbt)))
 #define FREE_DBT(dbt)    if ((dbt.flags & (DB_DBT_MALLOC|DB_DBT_REALLOC)) && \
                               dbt.data != NULL) { g_free(dbt.data); dbt.data = NULL; }
 
-static void tree_model_init (GtkTreeModelIface *iface);
+static void tree_model_init    (GtkTreeModelIface    *iface);
+static void tree_sortable_init (GtkTreeSortableIface *iface);
 
 G_DEFINE_TYPE_EXTENDED (BdbListStore, bdb_list_store, G_TYPE_OBJECT, 0,
-                        G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL, tree_model_init));
+                        G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL, tree_model_init)
+                        G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_SORTABLE, tree_sortable_init));
 
 #define LIST_STORE_PRIVATE(o)              \
 	(G_TYPE_INSTANCE_GET_PRIVATE ((o), \
@@ -19,17 +26,584 @@ G_DEFINE_TYPE_EXTENDED (BdbListStore, bdb_list_store, G_TYPE_OBJECT, 0,
 
 #define BDB_QUARK (g_quark_from_static_string("bdb-list-store"))
 
+#define DEFAULT_CACHE_SIZE (256 * 1024)
+#define WORKER_BATCH       64
+#define LOADER_BATCH       4096
+#define LOADER_BULK_SIZE   (1024 * 1024)
+
+#define COMPRESS_TAG       0xFF  /* never starts a UTF-8 string */
+#define COMPRESS_MIN_SIZE  128
+#define TRAIN_SAMPLE_RATIO 100   /* sample bytes per dictionary byte */
+#define CHANGE_LOG_INTERVAL 250  /* msec between change log polls */
+
+/* DB->put() learned DB_MULTIPLE_KEY in 4.8 */
+#if DB_VERSION_MAJOR > 4 || (DB_VERSION_MAJOR == 4 && DB_VERSION_MINOR >= 8)
+#define HAVE_BULK_PUT 1
+#endif
+
 typedef struct _BdbListStorePrivate BdbListStorePrivate;
+typedef struct _CacheEntry          CacheEntry;
+typedef struct _Worker              Worker;
+typedef struct _Loader              Loader;
+typedef struct _Codec               Codec;
 
 struct _BdbListStorePrivate
 {
-	gint      stamp;
-	GType     g_type;
+	gint        stamp;
+	GType       g_type;
+	DB         *dbp;
+	gboolean    dirty;
+	gint        n_keys;
+	gboolean    keyed;          /* DB_BTREE/DB_RECNUM instead of DB_RECNO */
+	
+	DB         *sdbp;           /* DB_BTREE/DB_RECNUM secondary index */
+	gint        sort_column_id;
+	GtkSortType sort_order;
+	
+	GHashTable *cache;      /* row offset -> CacheEntry */
+	GQueue      cache_lru;  /* head is the most recently used row */
+	gsize       cache_size; /* bytes currently held by the cache */
+	gsize       cache_max;  /* memory budget, 0 disables the cache */
+	
+	Worker     *worker;     /* background I/O, NULL unless threaded */
+	GHashTable *pending;    /* rows painted with a placeholder */
+	guint       generation; /* bumped whenever queued reads go stale */
+	gboolean    reordering; /* views await the rows-reordered of a sort switch */
+	
+	Loader     *loader;     /* file being appended, NULL when idle */
+	Codec      *codec;      /* value compression, NULL when off */
+	
+	DB         *log;        /* shared change log, NULL when not shared */
+	guint32     writer;     /* tags our own change log entries */
+	db_recno_t  log_seen;   /* last change log entry applied */
+	guint       log_timeout;
+};
+
+typedef enum
+{
+	CHANGE_CHANGED,
+	CHANGE_INSERTED,
+	CHANGE_DELETED,
+} ChangeKind;
+
+/*
+ * One change log record. Positions are 1-based offsets in the primary
+ * database, whatever order the writing store was showing.
+ */
+typedef struct
+{
+	guint32 writer;
+	guint32 kind;
+	gint32  index;
+	gint32  count;
+} ChangeEntry;
+
+/*
+ * Values of at least COMPRESS_MIN_SIZE bytes are stored as
+ * COMPRESS_TAG followed by a zstd frame of the string including its
+ * NUL; everything else is stored as the plain string. Decoding goes by
+ * the tag, so old and new records mix freely.
+ */
+struct _Codec
+{
+	gint         level;      /* 0 stores new values uncompressed */
+	GBytes      *dictionary;
+	ZSTD_CDict  *cdict;
+	ZSTD_DDict  *ddict;
+};
+
+/*
+ * A decoded row kept in memory so that repaints do not go back to
+ * DB->get. Entries are keyed by the same 1-based offset that is
+ * stored in iter->user_data.
+ */
+struct _CacheEntry
+{
+	GList   link;
+	gint    index;
+	gsize   size;
+	gchar  *str;
+};
+
+/*
+ * Everything needed to read rows in the current order, copied so that
+ * the I/O thread never looks at the private struct.
+ */
+typedef struct
+{
 	DB       *dbp;
-	gboolean  dirty;
-	gint      n_keys;
+	DB       *sdbp;       /* set when reading in index order */
+	gboolean  keyed;
+	gboolean  descending;
+	gint      n_keys;     /* for descending reads and OP_REORDER */
+	Codec    *codec;
+} RowSource;
+
+typedef enum
+{
+	OP_READ,
+	OP_PREFETCH,
+	OP_WRITE,
+	OP_FLUSH,
+	OP_REORDER,
+	OP_QUIT,
+} OpType;
+
+typedef struct
+{
+	OpType     type;
+	guint      generation;
+	RowSource  src;
+	gint       index;      /* first row, 1-based */
+	gint       n_rows;     /* OP_PREFETCH */
+	gint       serial;     /* OP_PREFETCH, only the latest request runs */
+	DBT        key;        /* OP_WRITE, g_malloc'd primary key */
+	DB        *log;        /* OP_WRITE, change log to append to */
+	guint32    writer;     /* OP_WRITE */
+	gchar     *str;        /* OP_WRITE */
+	gsize      len;        /* OP_WRITE */
+	gboolean   to_sorted;  /* OP_REORDER, direction of the switch */
+} Op;
+
+typedef struct
+{
+	guint   generation;
+	gint    index;
+	gchar  *str;
+	gsize   len;
+} RowResult;
+
+/*
+ * The I/O thread. It owns nothing but its queues; rows it reads are
+ * handed back in batches and applied on the main loop, where the cache
+ * lives and model signals may be emitted.
+ */
+struct _Worker
+{
+	GThread      *thread;
+	GAsyncQueue  *ops;
+	BdbListStore *store;
+	
+	GMutex        lock;
+	GCond         cond;
+	GPtrArray    *results;  /* RowResult, guarded by lock */
+	guint         idle_id;  /* guarded by lock */
+	gint          flushed;  /* guarded by lock */
+	gint          flushes;  /* main thread only */
+	gint         *reorder;  /* built for OP_REORDER, guarded by lock */
+	gboolean      reordered; /* whether reorder is ready, guarded by lock */
+	
+	volatile gint prefetch_serial;
 };
 
+/*
+ * Appends the lines of a mapped file from its own thread. The loader
+ * is the only writer in this process while it runs, so record numbers
+ * are assigned up front and rows are exposed to the view as whole
+ * batches land. With a change log attached other processes may append
+ * too, so every record is written with DB_NOOVERWRITE and the load stops
+ * at the first record number someone else has taken.
+ */
+struct _Loader
+{
+	GThread              *thread;
+	BdbListStore         *store;
+	DB                   *dbp;
+	GMappedFile          *file;
+	Codec                *codec;
+	DB                   *log;
+	guint32               writer;
+	db_recno_t            base;     /* rows before the load started */
+	volatile gint         cancelled;
+	
+	DBT                   bulk;
+	void                 *ptr;      /* write cursor into bulk, NULL if reset */
+	gint                  n_bulk;
+	db_recno_t            last;      /* last record packed into bulk */
+	db_recno_t            committed; /* last record known to be written */
+	GString              *scratch;
+	
+	GMutex                lock;
+	gint                  appended; /* guarded by lock */
+	goffset               loaded;   /* guarded by lock */
+	gboolean              finished; /* guarded by lock */
+	GError               *error;    /* guarded by lock */
+	guint                 idle_id;  /* guarded by lock */
+	
+	gint                  exposed;  /* main thread only */
+	BdbListStoreLoadFunc  func;
+	gpointer              user_data;
+	GDestroyNotify        notify;
+};
+
+enum
+{
+	PROP_0,
+	PROP_CACHE_SIZE,
+};
+
+static void
+cache_entry_free (gpointer data)
+{
+	CacheEntry *entry = data;
+	
+	g_free (entry->str);
+	g_slice_free (CacheEntry, entry);
+}
+
+static void
+cache_remove_entry (BdbListStorePrivate *priv, CacheEntry *entry)
+{
+	g_queue_unlink (&priv->cache_lru, &entry->link);
+	priv->cache_size -= entry->size;
+	g_hash_table_remove (priv->cache, GINT_TO_POINTER (entry->index));
+}
+
+static void
+cache_trim (BdbListStorePrivate *priv)
+{
+	while (priv->cache_size > priv->cache_max && priv->cache_lru.tail != NULL)
+		cache_remove_entry (priv, priv->cache_lru.tail->data);
+}
+
+static const gchar*
+cache_lookup (BdbListStorePrivate *priv, gint index)
+{
+	CacheEntry *entry;
+	
+	if (!(entry = g_hash_table_lookup (priv->cache, GINT_TO_POINTER (index))))
+		return NULL;
+	
+	if (priv->cache_lru.head != &entry->link) {
+		g_queue_unlink (&priv->cache_lru, &entry->link);
+		g_queue_push_head_link (&priv->cache_lru, &entry->link);
+	}
+	
+	return entry->str;
+}
+
+/*
+ * Takes ownership of @str, which must be allocated with g_malloc().
+ * Rows larger than the whole budget are dropped immediately.
+ */
+static void
+cache_insert (BdbListStorePrivate *priv, gint index, gchar *str, gsize len)
+{
+	CacheEntry *entry;
+	gsize       size = sizeof (CacheEntry) + len;
+	
+	if ((entry = g_hash_table_lookup (priv->cache, GINT_TO_POINTER (index))))
+		cache_remove_entry (priv, entry);
+	
+	if (size > priv->cache_max) {
+		g_free (str);
+		return;
+	}
+	
+	entry = g_slice_new0 (CacheEntry);
+	entry->link.data = entry;
+	entry->index = index;
+	entry->size = size;
+	entry->str = str;
+	
+	g_hash_table_insert (priv->cache, GINT_TO_POINTER (index), entry);
+	g_queue_push_head_link (&priv->cache_lru, &entry->link);
+	priv->cache_size += size;
+	
+	cache_trim (priv);
+}
+
+static void
+cache_invalidate (BdbListStorePrivate *priv, gint index)
+{
+	CacheEntry *entry;
+	
+	if ((entry = g_hash_table_lookup (priv->cache, GINT_TO_POINTER (index))))
+		cache_remove_entry (priv, entry);
+}
+
+/*
+ * Drops the cached rows between @first and @last inclusive.
+ */
+static void
+cache_invalidate_range (BdbListStorePrivate *priv, gint first, gint last)
+{
+	GList *iter = priv->cache_lru.head;
+	
+	while (iter != NULL) {
+		CacheEntry *entry = iter->data;
+		iter = iter->next;
+		if (entry->index >= first && entry->index <= last)
+			cache_remove_entry (priv, entry);
+	}
+}
+
+/*
+ * Drops every cached row at or after @index. Used when a delete
+ * renumbers the tail of the database.
+ */
+static void
+cache_invalidate_from (BdbListStorePrivate *priv, gint index)
+{
+	GList *iter = priv->cache_lru.head;
+	
+	while (iter != NULL) {
+		CacheEntry *entry = iter->data;
+		iter = iter->next;
+		if (entry->index >= index)
+			cache_remove_entry (priv, entry);
+	}
+}
+
+static gboolean
+cache_contains (BdbListStorePrivate *priv, gint index)
+{
+	return g_hash_table_lookup (priv->cache, GINT_TO_POINTER (index)) != NULL;
+}
+
+static void
+cache_clear (BdbListStorePrivate *priv)
+{
+	while (priv->cache_lru.head != NULL)
+		cache_remove_entry (priv, priv->cache_lru.head->data);
+}
+
+/* Records a change for other processes sharing the environment */
+static void
+change_log_append (DB *log, guint32 writer, ChangeKind kind, gint index, gint count)
+{
+	ChangeEntry entry;
+	db_recno_t recno = 0;
+	DBT key, data;
+	gint ret;
+	
+	if (log == NULL || count == 0)
+		return;
+	
+	entry.writer = writer;
+	entry.kind = kind;
+	entry.index = index;
+	entry.count = count;
+	
+	CLEAR_DBT (key);
+	CLEAR_DBT (data);
+	
+	key.data = &recno;
+	key.ulen = sizeof (db_recno_t);
+	key.flags = DB_DBT_USERMEM;
+	
+	data.data = &entry;
+	data.size = sizeof (ChangeEntry);
+	data.ulen = sizeof (ChangeEntry);
+	data.flags = DB_DBT_USERMEM;
+	
+	if ((ret = log->put (log, NULL, &key, &data, DB_APPEND)) != 0)
+		g_warning ("bdb-list-store change log: %s", db_strerror (ret));
+}
+
+static GPrivate cctx_key = G_PRIVATE_INIT ((GDestroyNotify) ZSTD_freeCCtx);
+static GPrivate dctx_key = G_PRIVATE_INIT ((GDestroyNotify) ZSTD_freeDCtx);
+
+/* zstd contexts are reused per thread: main loop, worker and loader */
+static ZSTD_CCtx *
+get_cctx (void)
+{
+	ZSTD_CCtx *cctx = g_private_get (&cctx_key);
+	
+	if (cctx == NULL) {
+		cctx = ZSTD_createCCtx ();
+		g_private_set (&cctx_key, cctx);
+	}
+	
+	return cctx;
+}
+
+static ZSTD_DCtx *
+get_dctx (void)
+{
+	ZSTD_DCtx *dctx = g_private_get (&dctx_key);
+	
+	if (dctx == NULL) {
+		dctx = ZSTD_createDCtx ();
+		g_private_set (&dctx_key, dctx);
+	}
+	
+	return dctx;
+}
+
+static void
+codec_free (Codec *codec)
+{
+	if (codec == NULL)
+		return;
+	
+	if (codec->cdict)
+		ZSTD_freeCDict (codec->cdict);
+	if (codec->ddict)
+		ZSTD_freeDDict (codec->ddict);
+	if (codec->dictionary)
+		g_bytes_unref (codec->dictionary);
+	
+	g_slice_free (Codec, codec);
+}
+
+/*
+ * Packs the @len bytes at @str, NUL included. Returns a g_malloc'd
+ * record and its size in @out_len, or NULL when the value is small or
+ * does not shrink and should be stored as is.
+ */
+static gpointer
+value_compress (const Codec *codec, const gchar *str, gsize len, gsize *out_len)
+{
+	guchar *buf;
+	gsize bound, ret;
+	
+	if (codec == NULL || codec->level == 0 || len < COMPRESS_MIN_SIZE)
+		return NULL;
+	
+	bound = ZSTD_compressBound (len);
+	buf = g_malloc (bound + 1);
+	buf[0] = COMPRESS_TAG;
+	
+	if (codec->cdict)
+		ret = ZSTD_compress_usingCDict (get_cctx (), buf + 1, bound, str, len, codec->cdict);
+	else
+		ret = ZSTD_compressCCtx (get_cctx (), buf + 1, bound, str, len, codec->level);
+	
+	if (ZSTD_isError (ret) || ret + 1 >= len) {
+		g_free (buf);
+		return NULL;
+	}
+	
+	*out_len = ret + 1;
+	return buf;
+}
+
+/*
+ * Fills @data for storing @str. Returns the buffer @data points into
+ * when it had to be allocated, for the caller to g_free().
+ */
+static gpointer
+value_encode (const Codec *codec, const gchar *str, gsize len, DBT *data)
+{
+	gpointer buf = value_compress (codec, str, len, &len);
+	
+	data->data = buf ? buf : (gpointer)str;
+	data->size = len;
+	data->ulen = len;
+	data->flags = DB_DBT_USERMEM;
+	
+	return buf;
+}
+
+/*
+ * Unpacks a stored record into a g_malloc'd string, or returns NULL
+ * when the record holds a plain string. Records that do not decode,
+ * e.g. because they were packed with a dictionary we were not given,
+ * read as empty.
+ */
+static gchar *
+value_decompress (const Codec *codec, gconstpointer record, gsize size, gsize *len)
+{
+	const guchar *buf = record;
+	unsigned long long content;
+	gchar *str;
+	gsize ret;
+	
+	if (size == 0 || buf[0] != COMPRESS_TAG)
+		return NULL;
+	
+	content = ZSTD_getFrameContentSize (buf + 1, size - 1);
+	
+	if (content != ZSTD_CONTENTSIZE_ERROR && content != ZSTD_CONTENTSIZE_UNKNOWN && content > 0) {
+		str = g_malloc (content);
+		
+		if (codec && codec->ddict)
+			ret = ZSTD_decompress_usingDDict (get_dctx (), str, content,
+			                                  buf + 1, size - 1, codec->ddict);
+		else
+			ret = ZSTD_decompressDCtx (get_dctx (), str, content, buf + 1, size - 1);
+		
+		if (!ZSTD_isError (ret) && ret == content && str[content - 1] == '\0') {
+			*len = content;
+			return str;
+		}
+		
+		g_free (str);
+	}
+	
+	g_warning ("bdb-list-store: could not decompress record");
+	*len = 1;
+	return g_strdup ("");
+}
+
+/* Takes ownership of the DB_DBT_MALLOC buffer in @data */
+static gchar *
+value_decode (const Codec *codec, DBT *data, gsize *len)
+{
+	gchar *str;
+	
+	if ((str = value_decompress (codec, data->data, data->size, len)) != NULL) {
+		g_free (data->data);
+	}
+	else {
+		str = data->data;
+		*len = data->size;
+	}
+	
+	data->data = NULL;
+	return str;
+}
+
+/*
+ * Secondary keys are the NUL terminated string followed by the primary
+ * key. DB_RECNUM cannot be combined with DB_DUP, so the primary key is
+ * what keeps rows with equal strings apart. The buffer comes from
+ * malloc() since Berkeley DB releases DB_DBT_APPMALLOC data with free().
+ */
+static gpointer
+build_sort_key (const DBT *pkey, const DBT *pdata, u_int32_t *size)
+{
+	gchar *buf;
+	
+	if ((buf = malloc (pdata->size + pkey->size)) == NULL)
+		return NULL;
+	
+	memcpy (buf, pdata->data, pdata->size);
+	memcpy (buf + pdata->size, pkey->data, pkey->size);
+	*size = pdata->size + pkey->size;
+	
+	return buf;
+}
+
+static int
+sort_key_callback (DB *sdbp, const DBT *pkey, const DBT *pdata, DBT *skey)
+{
+	u_int32_t size;
+	gpointer  buf;
+	gchar    *str;
+	gsize     len;
+	DBT       plain = *pdata;
+	
+	/* the index orders by value, not by its packed form */
+	if ((str = value_decompress (sdbp->app_private, pdata->data, pdata->size, &len)) != NULL) {
+		plain.data = str;
+		plain.size = len;
+	}
+	
+	buf = build_sort_key (pkey, &plain, &size);
+	g_free (str);
+	
+	if (buf == NULL)
+		return ENOMEM;
+	
+	skey->data = buf;
+	skey->size = size;
+	skey->flags = DB_DBT_APPMALLOC;
+	
+	return 0;
+}
+
 static void
 bdb_list_store_get_property (GObject    *object,
                               guint       property_id,
@@ -37,6 +611,9 @@ bdb_list_store_get_property (GObject    *object,
                               GParamSpec *pspec)
 {
 	switch (property_id) {
+	case PROP_CACHE_SIZE:
+		g_value_set_ulong (value, bdb_list_store_get_cache_size (BDB_LIST_STORE (object)));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 	}
@@ -49,14 +626,30 @@ bdb_list_store_set_property (GObject      *object,
 			      GParamSpec   *pspec)
 {
 	switch (property_id) {
+	case PROP_CACHE_SIZE:
+		bdb_list_store_set_cache_size (BDB_LIST_STORE (object), g_value_get_ulong (value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 	}
 }
 
+static void worker_stop (BdbListStore *self);
+static void loader_stop (BdbListStore *self);
+
 static void
 bdb_list_store_dispose (GObject *object)
 {
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (object);
+	
+	if (priv->log_timeout) {
+		g_source_remove (priv->log_timeout);
+		priv->log_timeout = 0;
+	}
+	
+	loader_stop (BDB_LIST_STORE (object));
+	worker_stop (BDB_LIST_STORE (object));
+	
 	if (G_OBJECT_CLASS (bdb_list_store_parent_class)->dispose)
 		G_OBJECT_CLASS (bdb_list_store_parent_class)->dispose (object);
 }
@@ -64,6 +657,13 @@ bdb_list_store_dispose (GObject *object)
 static void
 bdb_list_store_finalize (GObject *object)
 {
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (object);
+	
+	cache_clear (priv);
+	g_hash_table_destroy (priv->cache);
+	g_hash_table_destroy (priv->pending);
+	codec_free (priv->codec);
+	
 	G_OBJECT_CLASS (bdb_list_store_parent_class)->finalize (object);
 }
 
@@ -78,6 +678,16 @@ bdb_list_store_class_init (BdbListStoreClass *klass)
 	object_class->set_property = bdb_list_store_set_property;
 	object_class->dispose      = bdb_list_store_dispose;
 	object_class->finalize     = bdb_list_store_finalize;
+	
+	g_object_class_install_property (object_class,
+	                                 PROP_CACHE_SIZE,
+	                                 g_param_spec_ulong ("cache-size",
+	                                                     "Cache Size",
+	                                                     "Memory budget in bytes for decoded rows",
+	                                                     0,
+	                                                     G_MAXULONG,
+	                                                     DEFAULT_CACHE_SIZE,
+	                                                     G_PARAM_READWRITE));
 }
 
 static gint
@@ -102,243 +712,2456 @@ get_n_keys (BdbListStore *self)
 	return priv->n_keys;
 }
 
-static GtkTreeModelFlags
-get_flags (GtkTreeModel *tree_model)
+/*
+ * Accounts for rows we added or removed. Without a change log the
+ * count is simply read again; with one, rows written by others only
+ * count once their log entry is applied, so the count is kept by hand.
+ */
+static void
+adjust_n_keys (BdbListStorePrivate *priv, gint delta)
 {
-	return GTK_TREE_MODEL_LIST_ONLY;
+	if (priv->log != NULL && !priv->dirty)
+		priv->n_keys += delta;
+	else
+		priv->dirty = TRUE;
 }
 
 static gboolean
-get_iter (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path)
+is_sorted (BdbListStorePrivate *priv)
 {
-	g_return_val_if_fail (BDB_IS_LIST_STORE (tree_model), FALSE);
+	return priv->sdbp != NULL && priv->sort_column_id == 0;
+}
+
+/*
+ * Maps a 1-based offset in the current order to a record number in
+ * the secondary index.
+ */
+static db_recno_t
+index_to_sort_recno (BdbListStore *self, gint index)
+{
+	if (LIST_STORE_PRIVATE (self)->sort_order == GTK_SORT_DESCENDING)
+		return get_n_keys (self) - index + 1;
+	return index;
+}
+
+static void
+get_row_source (BdbListStore *self, RowSource *src)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
 	
-	BdbListStorePrivate *priv    = LIST_STORE_PRIVATE (tree_model);
-	gint                *indices = gtk_tree_path_get_indices (path);
-	gint                 depth   = gtk_tree_path_get_depth (path);
+	src->dbp = priv->dbp;
+	src->sdbp = is_sorted (priv) ? priv->sdbp : NULL;
+	src->keyed = priv->keyed;
+	src->descending = (src->sdbp != NULL && priv->sort_order == GTK_SORT_DESCENDING);
+	src->n_keys = src->descending ? get_n_keys (self) : 0;
+	src->codec = priv->codec;
+}
+
+/*
+ * Reads the row at the 1-based @index in the order described by @src.
+ * On success @data, and @pkey when given, hold DB_DBT_MALLOC buffers
+ * which the caller releases with FREE_DBT. Renumbered recno stores read
+ * the record directly; keyed stores and sorted positions are resolved
+ * with DB_SET_RECNO, which is O(log n) in a DB_RECNUM btree. Safe to
+ * call from the I/O thread.
+ */
+static gint
+read_row_from (const RowSource *src, gint index, DBT *pkey, DBT *data)
+{
+	gboolean sorted = (src->sdbp != NULL);
+	DB *db = sorted ? src->sdbp : src->dbp;
+	DBT key, tmp;
+	DBC *dbc = NULL;
+	db_recno_t recno = index;
+	gint ret;
 	
-	if (depth == 0)
-		return FALSE;
+	CLEAR_DBT (key);
+	CLEAR_DBT (tmp);
+	
+	if (pkey == NULL)
+		pkey = &tmp;
+	
+	CLEAR_DBT (*pkey);
+	pkey->flags = DB_DBT_MALLOC;
+	
+	if (!sorted && !src->keyed) {
+		key.data = &recno;
+		key.size = sizeof (db_recno_t);
+		
+		if ((ret = src->dbp->get (src->dbp, NULL, &key, data, 0)) != 0)
+			return ret;
+		
+		pkey->data = g_new (db_recno_t, 1);
+		*(db_recno_t *)pkey->data = recno;
+		pkey->size = sizeof (db_recno_t);
+		FREE_DBT (tmp);
+		return 0;
+	}
 	
-	gint n_keys = get_n_keys (BDB_LIST_STORE (tree_model));
-	if (n_keys <= indices[0])
-		return FALSE;
+	if (src->descending)
+		recno = src->n_keys - index + 1;
 	
-	iter->stamp = priv->stamp;
-	iter->user_data = GINT_TO_POINTER (indices[0] + 1);
+	if ((ret = db->cursor (db, NULL, &dbc, 0)) != 0)
+		return ret;
 	
-	return TRUE;
+	key.data = &recno;
+	key.size = sizeof (db_recno_t);
+	key.flags = DB_DBT_MALLOC;
+	
+	if (sorted)
+		ret = dbc->pget (dbc, &key, pkey, data, DB_SET_RECNO);
+	else
+		ret = dbc->get (dbc, &key, data, DB_SET_RECNO);
+	
+	/* on success the recno buffer was replaced with the stored key */
+	if (key.data == &recno)
+		key.data = NULL;
+	
+	if (ret == 0 && !sorted) {
+		*pkey = key;
+		CLEAR_DBT (key);
+	}
+	
+	dbc->close (dbc);
+	FREE_DBT (key);
+	FREE_DBT (tmp);
+	
+	return ret;
 }
 
 static gint
-get_n_columns (GtkTreeModel *tree_model)
+read_row (BdbListStore *self, gint index, DBT *pkey, DBT *data)
 {
-	return 1;
+	RowSource src;
+	
+	get_row_source (self, &src);
+	return read_row_from (&src, index, pkey, data);
 }
 
-static GType
-get_column_type (GtkTreeModel *tree_model, gint index)
+/*
+ * Returns the 1-based record number of @key in @db, which must be a
+ * DB_BTREE created with DB_RECNUM, or 0 on failure.
+ */
+static gint
+key_to_recno (DB *db, DBT *key)
 {
-	return G_TYPE_STRING;
-	//return LIST_STORE_PRIVATE (tree_model)->g_type;
+	DBT data;
+	DBC *dbc = NULL;
+	db_recno_t recno = 0;
+	gint ret;
+	
+	if ((ret = db->cursor (db, NULL, &dbc, 0)) != 0)
+		return 0;
+	
+	CLEAR_DBT (data);
+	data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+	
+	if ((ret = dbc->get (dbc, key, &data, DB_SET)) == 0) {
+		CLEAR_DBT (data);
+		data.data = &recno;
+		data.ulen = sizeof (db_recno_t);
+		data.flags = DB_DBT_USERMEM;
+		ret = dbc->get (dbc, key, &data, DB_GET_RECNO);
+	}
+	
+	if (ret != 0)
+		g_warning ("key_to_recno: %s", db_strerror (ret));
+	
+	dbc->close (dbc);
+	
+	return (ret == 0) ? recno : 0;
 }
 
-static gboolean
-iter_next (GtkTreeModel *tree_model, GtkTreeIter *iter)
+/*
+ * Returns the 1-based record number of @skey in the secondary index
+ * @sdbp, or 0 on failure. DB_GET_RECNO through get() on a secondary
+ * cursor reports the primary's record number; pget() hands back the
+ * secondary's own in the primary key DBT.
+ */
+static gint
+sort_key_to_recno (DB *sdbp, DBT *skey)
 {
-	g_return_val_if_fail (BDB_IS_LIST_STORE (tree_model), FALSE);
+	DBT pkey, data;
+	DBC *dbc = NULL;
+	db_recno_t srecno = 0;
+	db_recno_t precno = 0;
+	gint ret;
 	
-	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (tree_model);
-	g_return_val_if_fail (iter->stamp == priv->stamp, FALSE);
+	if ((ret = sdbp->cursor (sdbp, NULL, &dbc, 0)) != 0)
+		return 0;
 	
-	gint n_keys = get_n_keys (BDB_LIST_STORE (tree_model));
-	gint next = GPOINTER_TO_INT (iter->user_data) + 1;
+	CLEAR_DBT (data);
+	data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+	
+	if ((ret = dbc->get (dbc, skey, &data, DB_SET)) == 0) {
+		CLEAR_DBT (pkey);
+		pkey.data = &srecno;
+		pkey.ulen = sizeof (db_recno_t);
+		pkey.flags = DB_DBT_USERMEM;
+		
+		CLEAR_DBT (data);
+		data.data = &precno;
+		data.ulen = sizeof (db_recno_t);
+		data.flags = DB_DBT_USERMEM;
+		
+		ret = dbc->pget (dbc, skey, &pkey, &data, DB_GET_RECNO);
+	}
 	
-	if (n_keys < next)
-		return FALSE;
+	if (ret != 0)
+		g_warning ("sort_key_to_recno: %s", db_strerror (ret));
 	
-	iter->user_data = GINT_TO_POINTER (next);
+	dbc->close (dbc);
 	
-	return TRUE;
+	return (ret == 0) ? srecno : 0;
 }
 
-static gboolean
-iter_nth_child (GtkTreeModel *tree_model,
-                GtkTreeIter *iter,
+/*
+ * Returns the 1-based offset at which the row (@pkey, @pdata) sits in
+ * the sorted order, or 0 on failure.
+ */
+static gint
+sorted_index (BdbListStore *self, const DBT *pkey, const DBT *pdata)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	DBT key;
+	gpointer buf;
+	gint recno;
+	
+	CLEAR_DBT (key);
+	
+	if ((buf = build_sort_key (pkey, pdata, &key.size)) == NULL)
+		return 0;
+	
+	key.data = buf;
+	recno = sort_key_to_recno (priv->sdbp, &key);
+	free (buf);
+	
+	if (recno == 0)
+		return 0;
+	
+	return index_to_sort_recno (self, recno);
+}
+
+static void
+op_free (Op *op)
+{
+	FREE_DBT (op->key);
+	g_free (op->str);
+	g_slice_free (Op, op);
+}
+
+static void
+row_result_free (RowResult *result)
+{
+	g_free (result->str);
+	g_slice_free (RowResult, result);
+}
+
+/* Takes ownership of the DB_DBT_MALLOC buffer in @data */
+static void
+push_result (GPtrArray *batch, const Op *op, gint index, DBT *data)
+{
+	RowResult *result = g_slice_new0 (RowResult);
+	
+	result->generation = op->generation;
+	result->index = index;
+	result->str = value_decode (op->src.codec, data, &result->len);
+	
+	g_ptr_array_add (batch, result);
+}
+
+/*
+ * Walks a cursor over @n_rows rows starting at @first. Besides handing
+ * the rows back, this pulls their pages into the mpool so the rows
+ * around the visible range are warm when the user scrolls.
+ */
+static void
+worker_prefetch (Op *op, GPtrArray *batch)
+{
+	const RowSource *src = &op->src;
+	DB *db = src->sdbp ? src->sdbp : src->dbp;
+	DBT key, data;
+	DBC *dbc = NULL;
+	db_recno_t recno;
+	u_int32_t flags;
+	gint index = op->index;
+	gint ret;
+	
+	if (db->cursor (db, NULL, &dbc, 0) != 0)
+		return;
+	
+	recno = src->descending ? src->n_keys - index + 1 : index;
+	
+	CLEAR_DBT (key);
+	CLEAR_DBT (data);
+	key.data = &recno;
+	key.size = sizeof (db_recno_t);
+	key.flags = DB_DBT_MALLOC;
+	data.flags = DB_DBT_MALLOC;
+	
+	/* renumbered recno databases are positioned by key, btrees by number */
+	flags = (db->type == DB_RECNO) ? DB_SET : DB_SET_RECNO;
+	ret = dbc->get (dbc, &key, &data, flags);
+	
+	while (ret == 0) {
+		push_result (batch, op, index, &data);
+		
+		if (key.data == &recno)
+			key.data = NULL;
+		FREE_DBT (key);
+		
+		if (++index >= op->index + op->n_rows)
+			break;
+		
+		CLEAR_DBT (key);
+		CLEAR_DBT (data);
+		key.flags = DB_DBT_MALLOC;
+		data.flags = DB_DBT_MALLOC;
+		ret = dbc->get (dbc, &key, &data, src->descending ? DB_PREV : DB_NEXT);
+	}
+	
+	if (key.data == &recno)
+		key.data = NULL;
+	FREE_DBT (key);
+	FREE_DBT (data);
+	
+	dbc->close (dbc);
+}
+
+/*
+ * Primary keys are kept length-prefixed in a GStringChunk while a
+ * permutation is built, one allocation per chunk rather than per row.
+ */
+static guint
+prefixed_key_hash (gconstpointer key)
+{
+	const guchar *p = (const guchar*)key + sizeof (guint32);
+	guint32 len, i;
+	guint hash = 5381;
+	
+	memcpy (&len, key, sizeof (guint32));
+	for (i = 0; i < len; i++)
+		hash = (hash << 5) + hash + p[i];
+	
+	return hash;
+}
+
+static gboolean
+prefixed_key_equal (gconstpointer a, gconstpointer b)
+{
+	guint32 len;
+	
+	memcpy (&len, a, sizeof (guint32));
+	return memcmp (a, b, sizeof (guint32) + len) == 0;
+}
+
+static void
+prefixed_key_set (GString *buf, const DBT *key)
+{
+	guint32 len = key->size;
+	
+	g_string_truncate (buf, 0);
+	g_string_append_len (buf, (const gchar*)&len, sizeof (guint32));
+	g_string_append_len (buf, key->data, key->size);
+}
+
+/*
+ * Numbers the first @n_keys primary keys in natural order, 1-based.
+ * Returns 0, or the Berkeley DB error that stopped the walk.
+ */
+static gint
+number_primary_keys (DB *dbp, gint n_keys, GHashTable *naturals, GStringChunk *chunk)
+{
+	GString *buf = g_string_new (NULL);
+	DBT key, data;
+	DBC *dbc = NULL;
+	gint i = 0;
+	gint ret;
+	
+	if ((ret = dbp->cursor (dbp, NULL, &dbc, 0)) != 0) {
+		g_string_free (buf, TRUE);
+		return ret;
+	}
+	
+	CLEAR_DBT (key);
+	CLEAR_DBT (data);
+	key.flags = DB_DBT_REALLOC;
+	data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+	
+	while (i < n_keys && (ret = dbc->get (dbc, &key, &data, DB_NEXT)) == 0) {
+		prefixed_key_set (buf, &key);
+		g_hash_table_insert (naturals, g_string_chunk_insert_len (chunk, buf->str, buf->len),
+		                     GINT_TO_POINTER (++i));
+	}
+	
+	dbc->close (dbc);
+	FREE_DBT (key);
+	g_string_free (buf, TRUE);
+	
+	return (ret == DB_NOTFOUND) ? 0 : ret;
+}
+
+/*
+ * Builds the rows-reordered permutation for a switch between the natural
+ * order and the index of a keyed store. One cursor walk numbers the
+ * primary keys in natural order, a second walks the index and looks each
+ * row's natural position up, so the cost is linear in the rows. GTK
+ * needs an entry for every row, so a partial permutation is not an
+ * option. @src->descending gives the direction of the index side.
+ * Returns NULL if the databases and the row count disagree. Safe to
+ * call from the I/O thread.
+ */
+static gint *
+build_sort_permutation (const RowSource *src, gboolean to_sorted)
+{
+	GHashTable *naturals;
+	GStringChunk *chunk;
+	GString *buf;
+	DBT skey, pkey, data;
+	DBC *dbc = NULL;
+	gint n_keys = src->n_keys;
+	gint *new_order;
+	gpointer found;
+	gint i = 0;
+	gint ret;
+	
+	naturals = g_hash_table_new (prefixed_key_hash, prefixed_key_equal);
+	chunk = g_string_chunk_new (64 * 1024);
+	
+	if ((ret = number_primary_keys (src->dbp, n_keys, naturals, chunk)) != 0 ||
+	    (ret = src->sdbp->cursor (src->sdbp, NULL, &dbc, 0)) != 0) {
+		g_warning ("build_sort_permutation: %s", db_strerror (ret));
+		g_string_chunk_free (chunk);
+		g_hash_table_destroy (naturals);
+		return NULL;
+	}
+	
+	new_order = g_new (gint, MAX (n_keys, 1));
+	buf = g_string_new (NULL);
+	
+	CLEAR_DBT (skey);
+	CLEAR_DBT (pkey);
+	CLEAR_DBT (data);
+	skey.flags = DB_DBT_REALLOC;
+	pkey.flags = DB_DBT_REALLOC;
+	data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+	
+	for (i = 0; (ret = dbc->pget (dbc, &skey, &pkey, &data, DB_NEXT)) == 0; i++) {
+		gint sorted = src->descending ? n_keys - i - 1 : i;
+		gint natural;
+		
+		prefixed_key_set (buf, &pkey);
+		if (i >= n_keys || (found = g_hash_table_lookup (naturals, buf->str)) == NULL)
+			break;
+		natural = GPOINTER_TO_INT (found) - 1;
+		
+		if (to_sorted)
+			new_order[sorted] = natural;
+		else
+			new_order[natural] = sorted;
+	}
+	
+	if (ret != 0 && ret != DB_NOTFOUND)
+		g_warning ("build_sort_permutation: %s", db_strerror (ret));
+	else if (ret == 0 || i != n_keys)
+		g_warning ("build_sort_permutation: the index does not match the %d rows", n_keys);
+	
+	if (ret != DB_NOTFOUND || i != n_keys) {
+		g_free (new_order);
+		new_order = NULL;
+	}
+	
+	dbc->close (dbc);
+	FREE_DBT (skey);
+	FREE_DBT (pkey);
+	g_string_free (buf, TRUE);
+	g_string_chunk_free (chunk);
+	g_hash_table_destroy (naturals);
+	
+	return new_order;
+}
+
+static gboolean worker_dispatch (gpointer data);
+
+/* Returns %TRUE when the worker should exit */
+static gboolean
+worker_run_op (Worker *worker, Op *op, GPtrArray *batch)
+{
+	gint *new_order;
+	DBT data;
+	gint ret;
+	
+	switch (op->type) {
+	case OP_READ:
+		CLEAR_DBT (data);
+		data.flags = DB_DBT_MALLOC;
+		if ((ret = read_row_from (&op->src, op->index, NULL, &data)) == 0)
+			push_result (batch, op, op->index, &data);
+		else
+			g_warning ("bdb-list-store worker: %s", db_strerror (ret));
+		break;
+	case OP_PREFETCH:
+		if (op->serial == g_atomic_int_get (&worker->prefetch_serial))
+			worker_prefetch (op, batch);
+		break;
+	case OP_WRITE:
+		CLEAR_DBT (data);
+		data.data = op->str;
+		data.size = op->len;
+		data.ulen = op->len;
+		data.flags = DB_DBT_USERMEM;
+		if ((ret = op->src.dbp->put (op->src.dbp, NULL, &op->key, &data, 0)) != 0)
+			g_warning ("bdb-list-store worker: %s", db_strerror (ret));
+		else
+			change_log_append (op->log, op->writer, CHANGE_CHANGED, op->index, 1);
+		break;
+	case OP_REORDER:
+		new_order = build_sort_permutation (&op->src, op->to_sorted);
+		g_mutex_lock (&worker->lock);
+		g_free (worker->reorder);
+		worker->reorder = new_order;
+		worker->reordered = TRUE;
+		if (worker->idle_id == 0)
+			worker->idle_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE + 10,
+			                                   worker_dispatch, worker, NULL);
+		g_mutex_unlock (&worker->lock);
+		break;
+	case OP_FLUSH:
+		g_mutex_lock (&worker->lock);
+		worker->flushed++;
+		g_cond_signal (&worker->cond);
+		g_mutex_unlock (&worker->lock);
+		break;
+	case OP_QUIT:
+		return TRUE;
+	}
+	
+	return FALSE;
+}
+
+static void
+worker_post (Worker *worker, GPtrArray *batch)
+{
+	guint i;
+	
+	if (batch->len == 0)
+		return;
+	
+	g_mutex_lock (&worker->lock);
+	
+	for (i = 0; i < batch->len; i++)
+		g_ptr_array_add (worker->results, g_ptr_array_index (batch, i));
+	
+	/* run just ahead of GTK's redraw so results land in the next frame */
+	if (worker->idle_id == 0)
+		worker->idle_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE + 10,
+		                                   worker_dispatch, worker, NULL);
+	
+	g_mutex_unlock (&worker->lock);
+	
+	g_ptr_array_set_size (batch, 0);
+}
+
+static gpointer
+worker_thread (gpointer data)
+{
+	Worker *worker = data;
+	GPtrArray *batch = g_ptr_array_new ();
+	gboolean quit = FALSE;
+	Op *op;
+	
+	while (!quit) {
+		op = g_async_queue_pop (worker->ops);
+		
+		/* drain what is queued so results go back as one batch */
+		do {
+			quit = worker_run_op (worker, op, batch);
+			op_free (op);
+		} while (!quit && batch->len < WORKER_BATCH &&
+		         (op = g_async_queue_try_pop (worker->ops)) != NULL);
+		
+		worker_post (worker, batch);
+	}
+	
+	g_ptr_array_free (batch, TRUE);
+	
+	return NULL;
+}
+
+static void
+worker_push (Worker *worker, Op *op)
+{
+	g_async_queue_push (worker->ops, op);
+}
+
+static void
+worker_request_row (BdbListStore *self, gint index)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	Op *op;
+	
+	op = g_slice_new0 (Op);
+	op->type = OP_READ;
+	op->generation = priv->generation;
+	op->index = index;
+	get_row_source (self, &op->src);
+	
+	g_hash_table_insert (priv->pending, GINT_TO_POINTER (index), NULL);
+	worker_push (priv->worker, op);
+}
+
+static void
+emit_rows_reordered (BdbListStore *self, gint *new_order)
+{
+	GtkTreePath *path = gtk_tree_path_new ();
+	
+	gtk_tree_model_rows_reordered (GTK_TREE_MODEL (self), path, NULL, new_order);
+	gtk_tree_path_free (path);
+}
+
+/*
+ * Announces the permutation the worker built for the last switch of
+ * sort order. Views keep their old layout until then, so this has to
+ * happen before any other row is inserted, deleted or moved.
+ */
+static void
+worker_take_reorder (BdbListStore *self)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	Worker *worker = priv->worker;
+	gboolean ready;
+	gint *new_order;
+	
+	if (!priv->reordering)
+		return;
+	
+	g_mutex_lock (&worker->lock);
+	ready = worker->reordered;
+	new_order = worker->reorder;
+	worker->reorder = NULL;
+	worker->reordered = FALSE;
+	g_mutex_unlock (&worker->lock);
+	
+	if (!ready)
+		return;
+	
+	priv->reordering = FALSE;
+	
+	if (new_order != NULL)
+		emit_rows_reordered (self, new_order);
+	g_free (new_order);
+}
+
+/*
+ * Blocks until every operation queued so far has run. Structural
+ * changes go through this so that queued writes land before rows are
+ * renumbered under them.
+ */
+static void
+worker_flush (BdbListStore *self)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	Worker *worker = priv->worker;
+	Op *op;
+	
+	if (worker == NULL)
+		return;
+	
+	op = g_slice_new0 (Op);
+	op->type = OP_FLUSH;
+	
+	g_mutex_lock (&worker->lock);
+	worker->flushes++;
+	worker_push (worker, op);
+	while (worker->flushed < worker->flushes)
+		g_cond_wait (&worker->cond, &worker->lock);
+	g_mutex_unlock (&worker->lock);
+	
+	worker_take_reorder (self);
+	
+	/* anything still in flight was read against the old layout */
+	priv->generation++;
+}
+
+static void
+emit_row_changed (BdbListStore *self, gint index)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	
+	iter.stamp = LIST_STORE_PRIVATE (self)->stamp;
+	iter.user_data = GINT_TO_POINTER (index);
+	
+	path = gtk_tree_path_new_from_indices (index - 1, -1);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (self), path, &iter);
+	gtk_tree_path_free (path);
+}
+
+/*
+ * Applies a batch of rows read by the worker. Rows that were painted
+ * with a placeholder get a row-changed; stale rows that are still
+ * wanted are asked for again.
+ */
+static gboolean
+worker_dispatch (gpointer data)
+{
+	Worker *worker = data;
+	BdbListStore *self = worker->store;
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	GPtrArray *results;
+	RowResult *result;
+	gboolean wanted;
+	guint i;
+	
+	g_mutex_lock (&worker->lock);
+	results = worker->results;
+	worker->results = g_ptr_array_new ();
+	worker->idle_id = 0;
+	g_mutex_unlock (&worker->lock);
+	
+	worker_take_reorder (self);
+	
+	for (i = 0; i < results->len; i++) {
+		result = g_ptr_array_index (results, i);
+		wanted = g_hash_table_remove (priv->pending, GINT_TO_POINTER (result->index));
+		
+		if (result->generation != priv->generation) {
+			if (wanted)
+				worker_request_row (self, result->index);
+		}
+		else if (wanted || !cache_contains (priv, result->index)) {
+			cache_insert (priv, result->index, result->str, result->len);
+			result->str = NULL;
+			if (wanted)
+				emit_row_changed (self, result->index);
+		}
+		
+		row_result_free (result);
+	}
+	
+	g_ptr_array_free (results, TRUE);
+	
+	return FALSE;
+}
+
+static void
+worker_start (BdbListStore *self)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	Worker *worker;
+	
+	worker = g_slice_new0 (Worker);
+	worker->store = self;
+	worker->ops = g_async_queue_new ();
+	worker->results = g_ptr_array_new ();
+	g_mutex_init (&worker->lock);
+	g_cond_init (&worker->cond);
+	
+	priv->worker = worker;
+	priv->generation++;
+	
+	worker->thread = g_thread_new ("bdb-list-store", worker_thread, worker);
+}
+
+static void
+worker_stop (BdbListStore *self)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	Worker *worker = priv->worker;
+	GList *pending, *iter;
+	Op *op;
+	guint i;
+	
+	if (worker == NULL)
+		return;
+	
+	op = g_slice_new0 (Op);
+	op->type = OP_QUIT;
+	worker_push (worker, op);
+	g_thread_join (worker->thread);
+	
+	worker_take_reorder (self);
+	
+	priv->worker = NULL;
+	priv->generation++;
+	
+	if (worker->idle_id)
+		g_source_remove (worker->idle_id);
+	
+	for (i = 0; i < worker->results->len; i++)
+		row_result_free (g_ptr_array_index (worker->results, i));
+	g_ptr_array_free (worker->results, TRUE);
+	
+	while ((op = g_async_queue_try_pop (worker->ops)) != NULL)
+		op_free (op);
+	g_async_queue_unref (worker->ops);
+	
+	g_mutex_clear (&worker->lock);
+	g_cond_clear (&worker->cond);
+	g_slice_free (Worker, worker);
+	
+	/* placeholders are now read synchronously on the next repaint */
+	pending = g_hash_table_get_keys (priv->pending);
+	g_hash_table_remove_all (priv->pending);
+	
+	for (iter = pending; iter; iter = iter->next)
+		emit_row_changed (self, GPOINTER_TO_INT (iter->data));
+	
+	g_list_free (pending);
+}
+
+/*
+ * A record is @size bytes at @bytes, or with @terminate the @size - 1
+ * bytes of a line followed by a NUL.
+ */
+static gint
+loader_put (Loader *loader, db_recno_t recno, const gchar *bytes, gsize size, gboolean terminate)
+{
+	DBT key, data;
+	gint ret;
+	
+	CLEAR_DBT (key);
+	CLEAR_DBT (data);
+	
+	if (terminate) {
+		g_string_truncate (loader->scratch, 0);
+		g_string_append_len (loader->scratch, bytes, size - 1);
+		bytes = loader->scratch->str;
+	}
+	
+	key.data = &recno;
+	key.size = sizeof (db_recno_t);
+	key.ulen = sizeof (db_recno_t);
+	key.flags = DB_DBT_USERMEM;
+	
+	data.data = (void*)bytes;
+	data.size = size;
+	data.ulen = size;
+	data.flags = DB_DBT_USERMEM;
+	
+	if ((ret = loader->dbp->put (loader->dbp, NULL, &key, &data,
+	                             loader->log != NULL ? DB_NOOVERWRITE : 0)) == 0)
+		loader->committed = recno;
+	
+	return ret;
+}
+
+static gint
+loader_flush (Loader *loader)
+{
+#ifdef HAVE_BULK_PUT
+	DBT data;
+	gint ret;
+	
+	if (loader->n_bulk == 0)
+		return 0;
+	
+	CLEAR_DBT (data);
+	ret = loader->dbp->put (loader->dbp, NULL, &loader->bulk, &data, DB_MULTIPLE_KEY);
+	
+	if (ret == 0)
+		loader->committed = loader->last;
+	
+	loader->ptr = NULL;
+	loader->n_bulk = 0;
+	
+	return ret;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Stores a record as @recno. With bulk put available records are
+ * packed into one buffer and written in a single call per megabyte.
+ */
+static gint
+loader_write (Loader *loader, db_recno_t recno, const gchar *bytes, gsize size, gboolean terminate)
+{
+#ifdef HAVE_BULK_PUT
+	void *dptr = NULL;
+	gint ret;
+	
+	/* bulk puts overwrite, which could clobber another process's rows */
+	if (loader->log != NULL)
+		return loader_put (loader, recno, bytes, size, terminate);
+	
+	if (loader->ptr == NULL)
+		DB_MULTIPLE_WRITE_INIT (loader->ptr, &loader->bulk);
+	
+	DB_MULTIPLE_RECNO_RESERVE_NEXT (loader->ptr, &loader->bulk, recno, dptr, size);
+	
+	if (loader->ptr == NULL) {
+		if ((ret = loader_flush (loader)) != 0)
+			return ret;
+		
+		DB_MULTIPLE_WRITE_INIT (loader->ptr, &loader->bulk);
+		DB_MULTIPLE_RECNO_RESERVE_NEXT (loader->ptr, &loader->bulk, recno, dptr, size);
+		
+		/* larger than the whole buffer */
+		if (loader->ptr == NULL)
+			return loader_put (loader, recno, bytes, size, terminate);
+	}
+	
+	if (terminate) {
+		memcpy (dptr, bytes, size - 1);
+		((gchar*)dptr)[size - 1] = '\0';
+	}
+	else {
+		memcpy (dptr, bytes, size);
+	}
+	
+	loader->last = recno;
+	loader->n_bulk++;
+	
+	return 0;
+#else
+	return loader_put (loader, recno, bytes, size, terminate);
+#endif
+}
+
+/* Stores the @len bytes at @line, compressing them when worthwhile */
+static gint
+loader_add (Loader *loader, db_recno_t recno, const gchar *line, gsize len)
+{
+	gpointer packed = NULL;
+	gsize size = len + 1;
+	gint ret;
+	
+	if (loader->codec != NULL && loader->codec->level != 0 && size >= COMPRESS_MIN_SIZE) {
+		g_string_truncate (loader->scratch, 0);
+		g_string_append_len (loader->scratch, line, len);
+		packed = value_compress (loader->codec, loader->scratch->str, size, &size);
+	}
+	
+	if (packed != NULL)
+		ret = loader_write (loader, recno, packed, size, FALSE);
+	else
+		ret = loader_write (loader, recno, line, size, TRUE);
+	
+	g_free (packed);
+	
+	return ret;
+}
+
+static gboolean loader_dispatch (gpointer data);
+
+static void
+loader_post (Loader *loader, gint appended, goffset loaded, gboolean finished, GError *error)
+{
+	g_mutex_lock (&loader->lock);
+	
+	loader->appended = appended;
+	loader->loaded = loaded;
+	loader->finished = finished;
+	loader->error = error;
+	
+	if (loader->idle_id == 0)
+		loader->idle_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE + 10,
+		                                   loader_dispatch, loader, NULL);
+	
+	g_mutex_unlock (&loader->lock);
+}
+
+static gpointer
+loader_thread (gpointer data)
+{
+	Loader *loader = data;
+	const gchar *contents = g_mapped_file_get_contents (loader->file);
+	gsize length = g_mapped_file_get_length (loader->file);
+	const gchar *p = contents;
+	const gchar *end = contents + length;
+	const gchar *nl;
+	GError *error = NULL;
+	db_recno_t recno = loader->committed = loader->base;
+	db_recno_t logged = loader->base;
+	gsize len;
+	gint n;
+	gint ret = 0;
+	
+#ifdef MADV_SEQUENTIAL
+	if (length > 0)
+		madvise ((void*)contents, length, MADV_SEQUENTIAL);
+#endif
+	
+	while (p < end && ret == 0) {
+		if (g_atomic_int_get (&loader->cancelled)) {
+			error = g_error_new (BDB_QUARK, 0, "Loading was cancelled");
+			break;
+		}
+		
+		/* memchr() is the SIMD newline scan on any modern libc */
+		for (n = 0; n < LOADER_BATCH && p < end && ret == 0; n++) {
+			if ((nl = memchr (p, '\n', end - p)) == NULL)
+				nl = end;
+			
+			len = nl - p;
+			if (len > 0 && p[len - 1] == '\r')
+				len--;
+			
+			ret = loader_add (loader, ++recno, p, len);
+			p = nl + 1;
+		}
+		
+		if (ret == 0)
+			ret = loader_flush (loader);
+		
+		change_log_append (loader->log, loader->writer, CHANGE_INSERTED,
+		                   logged + 1, loader->committed - logged);
+		logged = loader->committed;
+		
+		if (ret == 0)
+			loader_post (loader, loader->committed - loader->base,
+			             MIN (p, end) - contents, FALSE, NULL);
+	}
+	
+	if (ret == DB_KEYEXIST)
+		error = g_error_new (BDB_QUARK, ret, "Another process appended rows, loading stopped");
+	else if (ret != 0)
+		error = g_error_new (BDB_QUARK, ret, "%s", db_strerror (ret));
+	
+	/* whatever reached the database before an error is kept */
+	loader_post (loader, loader->committed - loader->base,
+	             MIN (p, end) - contents, TRUE, error);
+	
+	return NULL;
+}
+
+static void
+loader_free (Loader *loader)
+{
+	if (loader->notify)
+		loader->notify (loader->user_data);
+	
+	if (loader->error)
+		g_error_free (loader->error);
+	
+	g_mapped_file_unref (loader->file);
+	g_string_free (loader->scratch, TRUE);
+	g_free (loader->bulk.data);
+	g_mutex_clear (&loader->lock);
+	g_slice_free (Loader, loader);
+}
+
+/*
+ * Exposes the rows written since the last dispatch with one
+ * row-inserted each, then reports progress.
+ */
+static gboolean
+loader_dispatch (gpointer data)
+{
+	Loader *loader = data;
+	BdbListStore *self = loader->store;
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	gint appended;
+	goffset loaded;
+	gboolean finished;
+	GError *error;
+	
+	g_mutex_lock (&loader->lock);
+	appended = loader->appended;
+	loaded = loader->loaded;
+	finished = loader->finished;
+	error = loader->error;
+	loader->error = NULL;
+	loader->idle_id = 0;
+	g_mutex_unlock (&loader->lock);
+	
+	iter.stamp = priv->stamp;
+	
+	while (loader->exposed < appended) {
+		loader->exposed++;
+		priv->n_keys++;
+		
+		iter.user_data = GINT_TO_POINTER (priv->n_keys);
+		path = gtk_tree_path_new_from_indices (priv->n_keys - 1, -1);
+		gtk_tree_model_row_inserted (GTK_TREE_MODEL (self), path, &iter);
+		gtk_tree_path_free (path);
+	}
+	
+	if (loader->func)
+		loader->func (self, loaded, g_mapped_file_get_length (loader->file),
+		              finished, error, loader->user_data);
+	
+	if (error)
+		g_error_free (error);
+	
+	if (finished) {
+		if (loader->thread)
+			g_thread_join (loader->thread);
+		priv->loader = NULL;
+		adjust_n_keys (priv, 0);
+		loader_free (loader);
+	}
+	
+	return FALSE;
+}
+
+/* Cancels and joins the loader without reporting back */
+static void
+loader_stop (BdbListStore *self)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	Loader *loader = priv->loader;
+	
+	if (loader == NULL)
+		return;
+	
+	g_atomic_int_set (&loader->cancelled, TRUE);
+	g_thread_join (loader->thread);
+	
+	if (loader->idle_id)
+		g_source_remove (loader->idle_id);
+	
+	priv->loader = NULL;
+	adjust_n_keys (priv, 0);
+	loader_free (loader);
+}
+
+/* Applies another process' change to the natural, unsorted order */
+static void
+change_log_apply (BdbListStore *self, const ChangeEntry *entry)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	gint index, i;
+	
+	iter.stamp = priv->stamp;
+	
+	switch (entry->kind) {
+	case CHANGE_CHANGED:
+		for (i = 0; i < entry->count; i++) {
+			if ((index = entry->index + i) > priv->n_keys)
+				break;
+			cache_invalidate (priv, index);
+			emit_row_changed (self, index);
+		}
+		break;
+	case CHANGE_INSERTED:
+		index = CLAMP (entry->index, 1, priv->n_keys + 1);
+		cache_invalidate_from (priv, index);
+		for (i = 0; i < entry->count; i++, index++) {
+			priv->n_keys++;
+			iter.user_data = GINT_TO_POINTER (index);
+			path = gtk_tree_path_new_from_indices (index - 1, -1);
+			gtk_tree_model_row_inserted (GTK_TREE_MODEL (self), path, &iter);
+			gtk_tree_path_free (path);
+		}
+		break;
+	case CHANGE_DELETED:
+		index = entry->index;
+		cache_invalidate_from (priv, index);
+		for (i = 0; i < entry->count && index <= priv->n_keys; i++) {
+			priv->n_keys--;
+			path = gtk_tree_path_new_from_indices (index - 1, -1);
+			gtk_tree_model_row_deleted (GTK_TREE_MODEL (self), path);
+			gtk_tree_path_free (path);
+		}
+		break;
+	}
+}
+
+/*
+ * Sorted views cannot map primary positions to their own order without
+ * the rows themselves, so they settle the row count at the tail and
+ * repaint the rows they had cached, which are the ones on screen.
+ */
+static void
+change_log_refresh (BdbListStore *self, gint delta)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	GList *rows, *l;
+	
+	rows = g_hash_table_get_keys (priv->cache);
+	cache_clear (priv);
+	
+	iter.stamp = priv->stamp;
+	
+	for (; delta < 0 && priv->n_keys > 0; delta++) {
+		priv->n_keys--;
+		path = gtk_tree_path_new_from_indices (priv->n_keys, -1);
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (self), path);
+		gtk_tree_path_free (path);
+	}
+	
+	for (; delta > 0; delta--) {
+		priv->n_keys++;
+		iter.user_data = GINT_TO_POINTER (priv->n_keys);
+		path = gtk_tree_path_new_from_indices (priv->n_keys - 1, -1);
+		gtk_tree_model_row_inserted (GTK_TREE_MODEL (self), path, &iter);
+		gtk_tree_path_free (path);
+	}
+	
+	for (l = rows; l; l = l->next)
+		if (GPOINTER_TO_INT (l->data) <= priv->n_keys)
+			emit_row_changed (self, GPOINTER_TO_INT (l->data));
+	
+	g_list_free (rows);
+}
+
+/*
+ * Checks the change log for entries written by other processes. The
+ * common case is a single cursor lookup that finds nothing new.
+ */
+static gboolean
+change_log_poll (gpointer data)
+{
+	BdbListStore *self = data;
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	ChangeEntry entry;
+	GArray *entries;
+	db_recno_t recno;
+	DBT key, value;
+	DBC *dbc = NULL;
+	gint delta = 0;
+	guint i;
+	gint ret;
+	
+	/*
+	 * While loading, the row count belongs to the loader. While views
+	 * wait for a sort switch to be reordered, positions in their layout
+	 * would not match ours.
+	 */
+	if (priv->loader != NULL || priv->reordering)
+		return TRUE;
+	
+	if (priv->log->cursor (priv->log, NULL, &dbc, 0) != 0)
+		return TRUE;
+	
+	CLEAR_DBT (key);
+	CLEAR_DBT (value);
+	
+	recno = priv->log_seen + 1;
+	key.data = &recno;
+	key.size = sizeof (db_recno_t);
+	key.ulen = sizeof (db_recno_t);
+	key.flags = DB_DBT_USERMEM;
+	
+	value.data = &entry;
+	value.ulen = sizeof (ChangeEntry);
+	value.flags = DB_DBT_USERMEM;
+	
+	entries = g_array_new (FALSE, FALSE, sizeof (ChangeEntry));
+	
+	for (ret = dbc->get (dbc, &key, &value, DB_SET); ret == 0;
+	     ret = dbc->get (dbc, &key, &value, DB_NEXT)) {
+		priv->log_seen = recno;
+		if (value.size == sizeof (ChangeEntry) && entry.writer != priv->writer)
+			g_array_append_val (entries, entry);
+	}
+	
+	dbc->close (dbc);
+	
+	if (entries->len > 0) {
+		/* reads in flight may predate these changes */
+		priv->generation++;
+		
+		if (is_sorted (priv)) {
+			for (i = 0; i < entries->len; i++) {
+				entry = g_array_index (entries, ChangeEntry, i);
+				if (entry.kind == CHANGE_INSERTED)
+					delta += entry.count;
+				else if (entry.kind == CHANGE_DELETED)
+					delta -= entry.count;
+			}
+			change_log_refresh (self, delta);
+		}
+		else {
+			for (i = 0; i < entries->len; i++)
+				change_log_apply (self, &g_array_index (entries, ChangeEntry, i));
+		}
+	}
+	
+	g_array_free (entries, TRUE);
+	
+	return TRUE;
+}
+
+static gboolean
+check_not_loading (BdbListStorePrivate *priv, const gchar *func)
+{
+	if (priv->loader != NULL) {
+		g_warning ("%s: a file is being loaded into the store", func);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static GtkTreeModelFlags
+get_flags (GtkTreeModel *tree_model)
+{
+	return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gboolean
+get_iter (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (tree_model), FALSE);
+	
+	BdbListStorePrivate *priv    = LIST_STORE_PRIVATE (tree_model);
+	gint                *indices = gtk_tree_path_get_indices (path);
+	gint                 depth   = gtk_tree_path_get_depth (path);
+	
+	if (depth == 0)
+		return FALSE;
+	
+	gint n_keys = get_n_keys (BDB_LIST_STORE (tree_model));
+	if (n_keys <= indices[0])
+		return FALSE;
+	
+	iter->stamp = priv->stamp;
+	iter->user_data = GINT_TO_POINTER (indices[0] + 1);
+	
+	return TRUE;
+}
+
+static gint
+get_n_columns (GtkTreeModel *tree_model)
+{
+	return 1;
+}
+
+static GType
+get_column_type (GtkTreeModel *tree_model, gint index)
+{
+	return G_TYPE_STRING;
+	//return LIST_STORE_PRIVATE (tree_model)->g_type;
+}
+
+static gboolean
+iter_next (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (tree_model), FALSE);
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (tree_model);
+	g_return_val_if_fail (iter->stamp == priv->stamp, FALSE);
+	
+	gint n_keys = get_n_keys (BDB_LIST_STORE (tree_model));
+	gint next = GPOINTER_TO_INT (iter->user_data) + 1;
+	
+	if (n_keys < next)
+		return FALSE;
+	
+	iter->user_data = GINT_TO_POINTER (next);
+	
+	return TRUE;
+}
+
+static gboolean
+iter_nth_child (GtkTreeModel *tree_model,
+                GtkTreeIter *iter,
 		GtkTreeIter *parent,
 		gint n)
 {
-	g_return_val_if_fail (BDB_IS_LIST_STORE (tree_model), FALSE);
+	g_return_val_if_fail (BDB_IS_LIST_STORE (tree_model), FALSE);
+	
+	if (parent)
+		return FALSE;
+	
+	gint n_keys = 0;
+	if ((n_keys = get_n_keys (BDB_LIST_STORE (tree_model))) <= n)
+		return FALSE;
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (tree_model);
+	
+	iter->stamp = priv->stamp;
+	iter->user_data = GINT_TO_POINTER (n + 1);
+	
+	return TRUE;
+}
+
+static void
+get_value (GtkTreeModel *tree_model,
+	   GtkTreeIter  *iter,
+           gint          column,
+	   GValue       *value)
+{
+	g_return_if_fail (BDB_IS_LIST_STORE (tree_model));
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (tree_model);
+	g_return_if_fail (priv->stamp == iter->stamp);
+	
+	DBT data;
+	gint index;
+	const gchar *str;
+	gchar *row;
+	gsize len;
+	gint ret;
+	
+	index = GPOINTER_TO_INT (iter->user_data);
+	
+	if ((str = cache_lookup (priv, index)) != NULL) {
+		g_value_init (value, G_TYPE_STRING);
+		g_value_set_string (value, str);
+		return;
+	}
+	
+	/* paint a placeholder and let the worker fill in the row */
+	if (priv->worker != NULL && priv->cache_max > 0) {
+		g_value_init (value, G_TYPE_STRING);
+		g_value_set_static_string (value, "");
+		if (!g_hash_table_lookup_extended (priv->pending, GINT_TO_POINTER (index), NULL, NULL))
+			worker_request_row (BDB_LIST_STORE (tree_model), index);
+		return;
+	}
+	
+	CLEAR_DBT (data);
+	data.flags = DB_DBT_MALLOC;
+	
+	if ((ret = read_row (BDB_LIST_STORE (tree_model), index, NULL, &data)) != 0) {
+		g_warning ("get_value: %s", db_strerror (ret));
+		return;
+	}
+	
+	row = value_decode (priv->codec, &data, &len);
+	
+	g_value_init (value, G_TYPE_STRING);
+	g_value_set_string (value, row);
+	
+	/* the cache now owns the decoded row */
+	cache_insert (priv, index, row, len);
+}
+
+static gboolean
+iter_children (GtkTreeModel *tree_model,
+               GtkTreeIter  *iter,
+               GtkTreeIter  *parent)
+{
+	return FALSE;
+}
+
+static gboolean
+iter_has_child (GtkTreeModel *tree_model,
+                GtkTreeIter  *iter)
+{
+	return FALSE;
+}
+
+static int
+iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (tree_model), 0);
+	if (iter)
+		return 0;
+	return get_n_keys (BDB_LIST_STORE (tree_model));
+}
+
+static gboolean
+iter_parent (GtkTreeModel *tree_model,
+             GtkTreeIter  *iter,
+             GtkTreeIter  *parent)
+{
+	return FALSE;
+}
+
+static GtkTreePath*
+get_path (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (tree_model);
+	g_return_val_if_fail (priv->stamp == iter->stamp, NULL);
+	
+	gint index = GPOINTER_TO_INT (iter->user_data);
+	return gtk_tree_path_new_from_indices (index - 1, -1);
+}
+
+static void
+tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags       = get_flags;
+	iface->get_iter        = get_iter;
+	iface->get_n_columns   = get_n_columns;
+	iface->get_column_type = get_column_type;
+	iface->iter_next       = iter_next;
+	iface->iter_nth_child  = iter_nth_child;
+	iface->get_value       = get_value;
+	iface->iter_children   = iter_children;
+	iface->iter_has_child  = iter_has_child;
+	iface->iter_n_children = iter_n_children;
+	iface->iter_parent     = iter_parent;
+	iface->get_path        = get_path;
+}
+
+static gboolean
+get_sort_column_id (GtkTreeSortable *sortable,
+                    gint            *sort_column_id,
+                    GtkSortType     *order)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (sortable);
+	
+	if (sort_column_id)
+		*sort_column_id = priv->sort_column_id;
+	if (order)
+		*order = priv->sort_order;
+	
+	return priv->sort_column_id >= 0;
+}
+
+/*
+ * Switching direction on the same index is a plain reversal. Switching
+ * between the natural order and the index needs the position of every
+ * row in both orders, which build_sort_permutation() finds in two cursor
+ * walks. Threaded stores leave that to the I/O thread and announce the
+ * permutation once it is built; until then views keep showing their
+ * old layout with the new rows painted into it. Either way views hear
+ * about it through rows-reordered.
+ */
+static void
+set_sort_column_id (GtkTreeSortable *sortable,
+                    gint             sort_column_id,
+                    GtkSortType      order)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (sortable);
+	gboolean was_sorted = (priv->sort_column_id == 0);
+	gboolean reversed;
+	gint *new_order = NULL;
+	RowSource src;
+	gint n_keys;
+	
+	if (sort_column_id > 0) {
+		g_warning ("BdbListStore has no column %d to sort on", sort_column_id);
+		return;
+	}
+	
+	if (sort_column_id == 0 && priv->sdbp == NULL) {
+		g_warning ("Attach an index with bdb_list_store_set_sort_db() before sorting");
+		return;
+	}
+	
+	if (priv->sort_column_id == sort_column_id && priv->sort_order == order)
+		return;
+	
+	reversed = (sort_column_id == 0 && was_sorted);
+	
+	/* rows the loader has yet to expose would break the permutation */
+	if (!reversed && (sort_column_id == 0) != was_sorted &&
+	    !check_not_loading (priv, G_STRFUNC))
+		return;
+	
+	worker_flush (BDB_LIST_STORE (sortable));
+	
+	n_keys = get_n_keys (BDB_LIST_STORE (sortable));
+	
+	if (reversed) {
+		gint i;
+		
+		new_order = g_new (gint, MAX (n_keys, 1));
+		for (i = 0; i < n_keys; i++)
+			new_order[i] = n_keys - i - 1;
+	}
+	else if (sort_column_id == 0 || was_sorted) {
+		src.dbp = priv->dbp;
+		src.sdbp = priv->sdbp;
+		src.keyed = priv->keyed;
+		src.descending = (was_sorted ? priv->sort_order : order) == GTK_SORT_DESCENDING;
+		src.n_keys = n_keys;
+		src.codec = priv->codec;
+		
+		if (priv->worker != NULL) {
+			Op *op = g_slice_new0 (Op);
+			
+			op->type = OP_REORDER;
+			op->src = src;
+			op->to_sorted = (sort_column_id == 0);
+			worker_push (priv->worker, op);
+			priv->reordering = TRUE;
+		}
+		else {
+			new_order = build_sort_permutation (&src, sort_column_id == 0);
+		}
+	}
+	
+	priv->sort_column_id = sort_column_id;
+	priv->sort_order = order;
+	
+	cache_clear (priv);
+	
+	gtk_tree_sortable_sort_column_changed (sortable);
+	
+	if (new_order != NULL)
+		emit_rows_reordered (BDB_LIST_STORE (sortable), new_order);
+	g_free (new_order);
+}
+
+static void
+set_sort_func (GtkTreeSortable        *sortable,
+               gint                    sort_column_id,
+               GtkTreeIterCompareFunc  func,
+               gpointer                data,
+               GDestroyNotify          destroy)
+{
+	g_warning ("BdbListStore sorts through its Berkeley DB index, "
+	           "custom sort functions are not supported");
+}
+
+static void
+set_default_sort_func (GtkTreeSortable        *sortable,
+                       GtkTreeIterCompareFunc  func,
+                       gpointer                data,
+                       GDestroyNotify          destroy)
+{
+	g_warning ("BdbListStore sorts through its Berkeley DB index, "
+	           "custom sort functions are not supported");
+}
+
+/* The default order is the order of the primary database */
+static gboolean
+has_default_sort_func (GtkTreeSortable *sortable)
+{
+	return TRUE;
+}
+
+static void
+tree_sortable_init (GtkTreeSortableIface *iface)
+{
+	iface->get_sort_column_id    = get_sort_column_id;
+	iface->set_sort_column_id    = set_sort_column_id;
+	iface->set_sort_func         = set_sort_func;
+	iface->set_default_sort_func = set_default_sort_func;
+	iface->has_default_sort_func = has_default_sort_func;
+}
+
+static void
+bdb_list_store_init (BdbListStore *self)
+{
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
 	
-	if (parent)
+	priv->stamp = g_random_int ();
+	priv->n_keys = 0;
+	priv->dirty = TRUE;
+	priv->sort_column_id = GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+	priv->sort_order = GTK_SORT_ASCENDING;
+	
+	priv->cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+	                                     NULL, cache_entry_free);
+	priv->pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_queue_init (&priv->cache_lru);
+	priv->cache_size = 0;
+	priv->cache_max = DEFAULT_CACHE_SIZE;
+}
+
+BdbListStore*
+bdb_list_store_new (void)
+{
+	return g_object_new (BDB_TYPE_LIST_STORE, NULL);
+}
+
+/**
+ * bdb_list_store_set_cache_size:
+ * @self: A #BdbListStore
+ * @bytes: memory budget for decoded rows, 0 disables caching
+ *
+ * Rows read through the #GtkTreeModel interface are kept in an LRU
+ * cache in front of the database so that repeated repaints of the
+ * same rows do not reach the storage engine.
+ */
+void
+bdb_list_store_set_cache_size (BdbListStore *self, gsize bytes)
+{
+	g_return_if_fail (BDB_IS_LIST_STORE (self));
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	
+	priv->cache_max = bytes;
+	cache_trim (priv);
+	
+	g_object_notify (G_OBJECT (self), "cache-size");
+}
+
+gsize
+bdb_list_store_get_cache_size (BdbListStore *self)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), 0);
+	return LIST_STORE_PRIVATE (self)->cache_max;
+}
+
+DB*
+bdb_list_store_get_db (BdbListStore *self)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), NULL);
+	return LIST_STORE_PRIVATE (self)->dbp;
+}
+
+gboolean
+bdb_list_store_set_db (BdbListStore *self, DB *db, GError **error)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), FALSE);
+	g_return_val_if_fail (db != NULL, FALSE);
+	
+	if (db->type != DB_RECNO && db->type != DB_BTREE) {
+		if (error && *error == NULL)
+			*error = g_error_new_literal (BDB_QUARK, 0, "DB must be of type DB_RECNO or DB_BTREE");
+		return FALSE;
+	}
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	
+	if (priv->dbp != NULL) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Cannot set db twice");
+		return FALSE;
+	}
+	
+	guint flags = 0;
+	gint ret = 0;
+	
+	if ((ret = db->get_flags (db, &flags)) != 0) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Cannot retrieve db flags");
+		return FALSE;
+	}
+	
+	if (db->type == DB_RECNO && !(flags & DB_RENUMBER)) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please alter DB with db->set_flags(DB_RENUMBER)");
+		return FALSE;
+	}
+	
+	if (db->type == DB_BTREE && !(flags & DB_RECNUM)) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please alter DB with db->set_flags(DB_RECNUM)");
+		return FALSE;
+	}
+	
+	priv->dbp = db;
+	priv->keyed = (db->type == DB_BTREE);
+	
+	return TRUE;
+}
+
+/**
+ * bdb_list_store_set_sort_db:
+ * @self: A #BdbListStore
+ * @sdb: an open DB_BTREE database created with DB_RECNUM
+ * @error: return location for a #GError
+ *
+ * Associates @sdb with the store's database as a secondary index
+ * ordered by the row contents. Once attached, column 0 can be sorted
+ * through #GtkTreeSortable and rows in sorted order are fetched by
+ * record number from the index instead of materializing the list.
+ *
+ * Berkeley DB does not maintain secondaries for DB_RENUMBER databases,
+ * so the primary must keep its keys stable across deletes.
+ */
+gboolean
+bdb_list_store_set_sort_db (BdbListStore *self, DB *sdb, GError **error)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), FALSE);
+	g_return_val_if_fail (sdb != NULL, FALSE);
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	guint flags = 0;
+	gint ret = 0;
+	
+	if (priv->dbp == NULL) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please set the db before the sort db");
+		return FALSE;
+	}
+	
+	if (priv->sdbp != NULL) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Cannot set sort db twice");
+		return FALSE;
+	}
+	
+	if (sdb->type != DB_BTREE) {
+		if (error && *error == NULL)
+			*error = g_error_new_literal (BDB_QUARK, 0, "Sort DB must be of type DB_BTREE");
 		return FALSE;
+	}
+	
+	if ((ret = sdb->get_flags (sdb, &flags)) != 0 || !(flags & DB_RECNUM)) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please alter sort DB with db->set_flags(DB_RECNUM)");
+		return FALSE;
+	}
+	
+	if (priv->worker != NULL &&
+	    ((ret = sdb->get_open_flags (sdb, &flags)) != 0 || !(flags & DB_THREAD))) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Threaded stores need a sort DB opened with DB_THREAD");
+		return FALSE;
+	}
+	
+	if ((ret = priv->dbp->get_flags (priv->dbp, &flags)) != 0 || (flags & DB_RENUMBER)) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Cannot index a DB_RENUMBER database");
+		return FALSE;
+	}
+	
+	/* the key callback needs the codec to see through packed values */
+	sdb->app_private = priv->codec;
+	
+	if ((ret = priv->dbp->associate (priv->dbp, NULL, sdb, sort_key_callback, DB_CREATE)) != 0) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Cannot associate sort db: %s",
+			                      db_strerror (ret));
+		return FALSE;
+	}
+	
+	priv->sdbp = sdb;
+	
+	return TRUE;
+}
+
+DB*
+bdb_list_store_get_sort_db (BdbListStore *self)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), NULL);
+	return LIST_STORE_PRIVATE (self)->sdbp;
+}
+
+/**
+ * bdb_list_store_set_threaded:
+ * @self: A #BdbListStore
+ * @threaded: whether to move database I/O to a worker thread
+ * @error: return location for a #GError
+ *
+ * In threaded mode rows missing from the cache are painted empty and
+ * read by a worker thread, which also runs value writes and prefetches
+ * around the range given to bdb_list_store_set_visible_range(). Rows
+ * come back to the main loop in batches, each batch emitting its
+ * row-changed signals together, so the UI keeps painting while the
+ * mpool goes to disk. Inserts, removals and sort changes wait for the
+ * queued writes and then run on the calling thread.
+ *
+ * The database, and the sort database if any, must have been opened
+ * with DB_THREAD.
+ */
+gboolean
+bdb_list_store_set_threaded (BdbListStore *self, gboolean threaded, GError **error)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), FALSE);
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	guint flags = 0;
+	gint ret = 0;
+	
+	if (threaded == (priv->worker != NULL))
+		return TRUE;
+	
+	if (!threaded) {
+		worker_stop (self);
+		return TRUE;
+	}
+	
+	if (priv->dbp == NULL) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please set the db first");
+		return FALSE;
+	}
+	
+	if ((ret = priv->dbp->get_open_flags (priv->dbp, &flags)) != 0 || !(flags & DB_THREAD)) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please open DB with DB_THREAD");
+		return FALSE;
+	}
+	
+	if (priv->sdbp != NULL &&
+	    ((ret = priv->sdbp->get_open_flags (priv->sdbp, &flags)) != 0 || !(flags & DB_THREAD))) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please open sort DB with DB_THREAD");
+		return FALSE;
+	}
+	
+	worker_start (self);
+	
+	return TRUE;
+}
+
+gboolean
+bdb_list_store_get_threaded (BdbListStore *self)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), FALSE);
+	return LIST_STORE_PRIVATE (self)->worker != NULL;
+}
+
+/**
+ * bdb_list_store_set_visible_range:
+ * @self: A #BdbListStore
+ * @start: first visible row
+ * @end: last visible row
+ *
+ * Tells a threaded store which rows are on screen, typically from
+ * gtk_tree_view_get_visible_range() when the view scrolls. The worker
+ * prefetches one screenful on either side; rows already cached are
+ * skipped and a newer range supersedes any prefetch not yet started.
+ */
+void
+bdb_list_store_set_visible_range (BdbListStore *self,
+                                  GtkTreePath  *start,
+                                  GtkTreePath  *end)
+{
+	g_return_if_fail (BDB_IS_LIST_STORE (self));
+	g_return_if_fail (start != NULL);
+	g_return_if_fail (end != NULL);
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	gint first, last, span, n_keys;
+	Op *op;
+	
+	if (priv->worker == NULL || priv->cache_max == 0)
+		return;
+	
+	first = gtk_tree_path_get_indices (start)[0] + 1;
+	last = gtk_tree_path_get_indices (end)[0] + 1;
+	span = last - first + 1;
+	n_keys = get_n_keys (self);
+	
+	first = MAX (1, first - span);
+	last = MIN (n_keys, last + span);
+	
+	while (first <= last && cache_contains (priv, first))
+		first++;
+	while (last >= first && cache_contains (priv, last))
+		last--;
+	
+	if (first > last)
+		return;
+	
+	op = g_slice_new0 (Op);
+	op->type = OP_PREFETCH;
+	op->generation = priv->generation;
+	op->index = first;
+	op->n_rows = last - first + 1;
+	op->serial = g_atomic_int_add (&priv->worker->prefetch_serial, 1) + 1;
+	get_row_source (self, &op->src);
+	
+	worker_push (priv->worker, op);
+}
+
+/**
+ * bdb_list_store_set_change_log:
+ * @self: A #BdbListStore
+ * @log: a DB_RECNO database without DB_RENUMBER, opened with DB_THREAD
+ * @error: return location for a #GError
+ *
+ * Shares row changes with stores in other processes that open the same
+ * environment and pass the same @log. Every insert, removal and value
+ * change is appended to @log, whose last record number doubles as a
+ * sequence counter. The store polls that counter a few times a second
+ * and, when other writers have moved it, applies their entries as
+ * targeted row-inserted, row-deleted and row-changed signals. Sorted
+ * stores fix their row count and repaint the rows they have cached.
+ *
+ * The log only grows; truncate it while no process has it open.
+ */
+gboolean
+bdb_list_store_set_change_log (BdbListStore *self, DB *log, GError **error)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), FALSE);
+	g_return_val_if_fail (log != NULL, FALSE);
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	db_recno_t recno = 0;
+	guint flags = 0;
+	DBT key, data;
+	DBC *dbc = NULL;
+	gint ret;
+	
+	if (priv->dbp == NULL) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please set the db first");
+		return FALSE;
+	}
+	
+	if (priv->log != NULL || priv->loader != NULL) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Cannot set change log now");
+		return FALSE;
+	}
+	
+	if (log->type != DB_RECNO ||
+	    log->get_flags (log, &flags) != 0 || (flags & DB_RENUMBER)) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Change log must be a DB_RECNO without DB_RENUMBER");
+		return FALSE;
+	}
+	
+	if (log->get_open_flags (log, &flags) != 0 || !(flags & DB_THREAD)) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please open change log with DB_THREAD");
+		return FALSE;
+	}
+	
+	/* entries already in the log are part of what we are about to count */
+	if ((ret = log->cursor (log, NULL, &dbc, 0)) != 0) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "%s", db_strerror (ret));
+		return FALSE;
+	}
+	
+	CLEAR_DBT (key);
+	CLEAR_DBT (data);
+	key.data = &recno;
+	key.ulen = sizeof (db_recno_t);
+	key.flags = DB_DBT_USERMEM;
+	data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+	
+	if ((ret = dbc->get (dbc, &key, &data, DB_LAST)) != 0)
+		recno = 0;
+	
+	dbc->close (dbc);
+	
+	worker_flush (self);
+	priv->dirty = TRUE;
+	get_n_keys (self);
+	
+	priv->log = log;
+	priv->log_seen = recno;
+	priv->writer = g_random_int ();
+	priv->log_timeout = g_timeout_add (CHANGE_LOG_INTERVAL, change_log_poll, self);
+	
+	return TRUE;
+}
+
+DB*
+bdb_list_store_get_change_log (BdbListStore *self)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), NULL);
+	return LIST_STORE_PRIVATE (self)->log;
+}
+
+/**
+ * bdb_list_store_set_compression:
+ * @self: A #BdbListStore
+ * @level: zstd compression level, or 0 to store new values as is
+ * @dictionary: a dictionary from bdb_list_store_train_dictionary(), or %NULL
+ * @error: return location for a #GError
+ *
+ * Compresses values of at least 128 bytes with zstd as they are
+ * written; shorter values, and values that do not shrink, are stored
+ * as plain strings. Smaller records mean more rows per mpool page and
+ * fewer reads while scrolling. Decoded rows are kept in the row cache,
+ * so hot rows are decompressed once.
+ *
+ * Records carry their own marker, so existing plain records stay
+ * readable and compression may be turned on for a populated database.
+ * A dictionary is not stored in the database; records packed with one
+ * can only be read back when the same dictionary is set again, even
+ * with a @level of 0.
+ */
+gboolean
+bdb_list_store_set_compression (BdbListStore  *self,
+                                gint           level,
+                                GBytes        *dictionary,
+                                GError       **error)
+{
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), FALSE);
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	Codec *codec = NULL;
+	gconstpointer dict;
+	gsize dict_size;
 	
-	gint n_keys = 0;
-	if ((n_keys = get_n_keys (BDB_LIST_STORE (tree_model))) <= n)
+	if (priv->loader != NULL) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Cannot change compression while loading");
 		return FALSE;
+	}
 	
-	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (tree_model);
+	if (level != 0 || dictionary != NULL) {
+		codec = g_slice_new0 (Codec);
+		codec->level = level;
+		
+		if (dictionary != NULL) {
+			dict = g_bytes_get_data (dictionary, &dict_size);
+			codec->dictionary = g_bytes_ref (dictionary);
+			codec->ddict = ZSTD_createDDict (dict, dict_size);
+			if (level != 0)
+				codec->cdict = ZSTD_createCDict (dict, dict_size, level);
+			
+			if (codec->ddict == NULL || (level != 0 && codec->cdict == NULL)) {
+				codec_free (codec);
+				if (error && *error == NULL)
+					*error = g_error_new (BDB_QUARK, 0, "Invalid compression dictionary");
+				return FALSE;
+			}
+		}
+	}
 	
-	iter->stamp = priv->stamp;
-	iter->user_data = GINT_TO_POINTER (n);
+	/* queued reads and writes still point at the old codec */
+	worker_flush (self);
+	
+	codec_free (priv->codec);
+	priv->codec = codec;
+	
+	if (priv->sdbp != NULL)
+		priv->sdbp->app_private = codec;
 	
 	return TRUE;
 }
 
-static void
-get_value (GtkTreeModel *tree_model,
-	   GtkTreeIter  *iter,
-           gint          column,
-	   GValue       *value)
+/**
+ * bdb_list_store_train_dictionary:
+ * @self: A #BdbListStore
+ * @max_size: largest dictionary to build, in bytes
+ * @error: return location for a #GError
+ *
+ * Trains a zstd dictionary on the rows already in the store, reading
+ * about a hundred times @max_size bytes of them. Pass the result to
+ * bdb_list_store_set_compression() and keep it next to the database.
+ *
+ * Returns: the dictionary, or %NULL with @error set
+ */
+GBytes*
+bdb_list_store_train_dictionary (BdbListStore *self, gsize max_size, GError **error)
 {
-	g_return_if_fail (BDB_IS_LIST_STORE (tree_model));
-	
-	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (tree_model);
-	g_return_if_fail (priv->stamp == iter->stamp);
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), NULL);
+	g_return_val_if_fail (max_size > 0, NULL);
 	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	GByteArray *samples;
+	GArray *sizes;
 	DBT key, data;
-	db_recno_t keydata;
-	DB_TXN *txn = NULL;
-	gint ret;
-	gint flags = 0;
+	DBC *dbc = NULL;
+	gchar *str;
+	gsize len, ret;
+	gpointer dict;
+	gint err;
+	
+	if (priv->dbp == NULL) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please set the db first");
+		return NULL;
+	}
+	
+	if ((err = priv->dbp->cursor (priv->dbp, NULL, &dbc, 0)) != 0) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "%s", db_strerror (err));
+		return NULL;
+	}
+	
+	samples = g_byte_array_new ();
+	sizes = g_array_new (FALSE, FALSE, sizeof (size_t));
 	
 	CLEAR_DBT (key);
 	CLEAR_DBT (data);
-	
-	keydata = GPOINTER_TO_INT (iter->user_data);
-	key.data = &keydata;
+	key.flags = DB_DBT_MALLOC;
 	data.flags = DB_DBT_MALLOC;
 	
-	if ((ret = priv->dbp->get (priv->dbp, txn, &key, &data, flags)) != 0) {
-		g_warning ("get_value: %s", db_strerror (ret));
-		return;
+	while (samples->len < max_size * TRAIN_SAMPLE_RATIO &&
+	       dbc->get (dbc, &key, &data, DB_NEXT) == 0) {
+		str = value_decode (priv->codec, &data, &len);
+		
+		/* train on the text, without the terminating NUL */
+		if (len > 1) {
+			size_t sample = len - 1;
+			g_byte_array_append (samples, (guint8*)str, sample);
+			g_array_append_val (sizes, sample);
+		}
+		
+		g_free (str);
+		FREE_DBT (key);
+		key.flags = DB_DBT_MALLOC;
+		data.flags = DB_DBT_MALLOC;
 	}
 	
-	g_value_init (value, G_TYPE_STRING);
-	g_value_set_string (value, data.data);
+	dbc->close (dbc);
 	
-	FREE_DBT (key);
-	FREE_DBT (data);
-}
-
-static gboolean
-iter_children (GtkTreeModel *tree_model,
-               GtkTreeIter  *iter,
-               GtkTreeIter  *parent)
-{
-	return FALSE;
-}
-
-static gboolean
-iter_has_child (GtkTreeModel *tree_model,
-                GtkTreeIter  *iter)
-{
-	return FALSE;
-}
-
-static int
-iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter)
-{
-	g_return_val_if_fail (BDB_IS_LIST_STORE (tree_model), 0);
-	if (iter)
-		return 0;
-	return get_n_keys (BDB_LIST_STORE (tree_model));
+	dict = g_malloc (max_size);
+	ret = ZDICT_trainFromBuffer (dict, max_size, samples->data,
+	                             (size_t*)sizes->data, sizes->len);
+	
+	g_byte_array_free (samples, TRUE);
+	g_array_free (sizes, TRUE);
+	
+	if (ZDICT_isError (ret)) {
+		g_free (dict);
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Cannot train dictionary: %s",
+			                      ZDICT_getErrorName (ret));
+		return NULL;
+	}
+	
+	return g_bytes_new_take (dict, ret);
 }
 
-static gboolean
-iter_parent (GtkTreeModel *tree_model,
-             GtkTreeIter  *iter,
-             GtkTreeIter  *parent)
+/**
+ * bdb_list_store_load_file:
+ * @self: A #BdbListStore
+ * @filename: file to append, one row per line
+ * @func: progress callback, or %NULL
+ * @user_data: data for @func
+ * @notify: destroys @user_data once loading is over
+ * @error: return location for a #GError
+ *
+ * Appends every line of @filename without blocking the main loop. The
+ * file is mapped rather than read, split on newlines and written by a
+ * loader thread, a batch of lines per put where Berkeley DB supports
+ * bulk writes. Rows show up in the model a batch at a time while the
+ * rest of the file is still loading, and @func is called on the main
+ * loop after each batch and once more with @finished set.
+ *
+ * Only renumbered DB_RECNO stores opened with DB_THREAD can load files.
+ * Appending and removing rows is refused until the load is over. With a
+ * change log attached, rows are written one at a time without replacing
+ * existing records, and the load stops with an error if another process
+ * appends in the meantime.
+ */
+gboolean
+bdb_list_store_load_file (BdbListStore          *self,
+                          const gchar           *filename,
+                          BdbListStoreLoadFunc   func,
+                          gpointer               user_data,
+                          GDestroyNotify         notify,
+                          GError               **error)
 {
-	return FALSE;
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	GMappedFile *file;
+	Loader *loader;
+	guint flags = 0;
+	
+	if (priv->dbp == NULL || priv->keyed) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Files load into DB_RECNO stores only");
+		return FALSE;
+	}
+	
+	if (priv->dbp->get_open_flags (priv->dbp, &flags) != 0 || !(flags & DB_THREAD)) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "Please open DB with DB_THREAD");
+		return FALSE;
+	}
+	
+	if (priv->loader != NULL) {
+		if (error && *error == NULL)
+			*error = g_error_new (BDB_QUARK, 0, "A file is already loading");
+		return FALSE;
+	}
+	
+	if ((file = g_mapped_file_new (filename, FALSE, error)) == NULL)
+		return FALSE;
+	
+	/* queued writes must land before record numbers are handed out */
+	worker_flush (self);
+	
+	loader = g_slice_new0 (Loader);
+	loader->store = self;
+	loader->dbp = priv->dbp;
+	loader->file = file;
+	loader->codec = priv->codec;
+	loader->log = priv->log;
+	loader->writer = priv->writer;
+	loader->base = get_n_keys (self);
+	loader->scratch = g_string_new (NULL);
+	loader->bulk.data = g_malloc (LOADER_BULK_SIZE);
+	loader->bulk.ulen = LOADER_BULK_SIZE;
+#ifdef HAVE_BULK_PUT
+	loader->bulk.flags = DB_DBT_USERMEM | DB_DBT_BULK;
+#endif
+	loader->func = func;
+	loader->user_data = user_data;
+	loader->notify = notify;
+	g_mutex_init (&loader->lock);
+	
+	/* the row count now follows the loader rather than DB->stat() */
+	priv->n_keys = loader->base;
+	priv->dirty = FALSE;
+	priv->loader = loader;
+	
+	loader->thread = g_thread_new ("bdb-list-store-loader", loader_thread, loader);
+	
+	return TRUE;
 }
 
-static GtkTreePath*
-get_path (GtkTreeModel *tree_model, GtkTreeIter *iter)
+/**
+ * bdb_list_store_cancel_load:
+ * @self: A #BdbListStore
+ *
+ * Stops a load started with bdb_list_store_load_file(). Rows already
+ * written are kept, and the progress callback is called a last time
+ * with @finished set and a cancellation error.
+ */
+void
+bdb_list_store_cancel_load (BdbListStore *self)
 {
-	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (tree_model);
-	g_return_val_if_fail (priv->stamp == iter->stamp, NULL);
+	g_return_if_fail (BDB_IS_LIST_STORE (self));
 	
-	gint index = GPOINTER_TO_INT (iter->user_data);
-	return gtk_tree_path_new_from_indices (index - 1, -1);
+	Loader *loader = LIST_STORE_PRIVATE (self)->loader;
+	
+	if (loader == NULL)
+		return;
+	
+	g_atomic_int_set (&loader->cancelled, TRUE);
+	g_thread_join (loader->thread);
+	loader->thread = NULL;
+	
+	g_mutex_lock (&loader->lock);
+	if (loader->idle_id) {
+		g_source_remove (loader->idle_id);
+		loader->idle_id = 0;
+	}
+	g_mutex_unlock (&loader->lock);
+	
+	loader_dispatch (loader);
 }
 
-static void
-tree_model_init (GtkTreeModelIface *iface)
+gboolean
+bdb_list_store_is_loading (BdbListStore *self)
 {
-	iface->get_flags       = get_flags;
-	iface->get_iter        = get_iter;
-	iface->get_n_columns   = get_n_columns;
-	iface->get_column_type = get_column_type;
-	iface->iter_next       = iter_next;
-	iface->iter_nth_child  = iter_nth_child;
-	iface->get_value       = get_value;
-	iface->iter_children   = iter_children;
-	iface->iter_has_child  = iter_has_child;
-	iface->iter_n_children = iter_n_children;
-	iface->iter_parent     = iter_parent;
-	iface->get_path        = get_path;
+	g_return_val_if_fail (BDB_IS_LIST_STORE (self), FALSE);
+	return LIST_STORE_PRIVATE (self)->loader != NULL;
 }
 
-static void
-bdb_list_store_init (BdbListStore *self)
+/*
+ * Looks up the primary key of the row at @index. Unsorted recno
+ * stores use the offset itself and never touch the database.
+ */
+static gint
+get_primary_key (BdbListStore *self, gint index, DBT *pkey)
 {
 	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	DBT data;
+	gint ret;
 	
-	priv->stamp = g_random_int ();
-	priv->n_keys = 0;
-	priv->dirty = TRUE;
-}
-
-BdbListStore*
-bdb_list_store_new (void)
-{
-	return g_object_new (BDB_TYPE_LIST_STORE, NULL);
+	if (!is_sorted (priv) && !priv->keyed) {
+		db_recno_t recno = index;
+		
+		CLEAR_DBT (*pkey);
+		pkey->data = g_new (db_recno_t, 1);
+		*(db_recno_t *)pkey->data = recno;
+		pkey->size = sizeof (db_recno_t);
+		pkey->flags = DB_DBT_MALLOC;
+		return 0;
+	}
+	
+	CLEAR_DBT (data);
+	data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+	
+	ret = read_row (self, index, pkey, &data);
+	FREE_DBT (data);
+	
+	return ret;
 }
 
-DB*
-bdb_list_store_get_db (BdbListStore *self)
+/**
+ * bdb_list_store_get_key:
+ * @self: A #BdbListStore
+ * @iter: A valid #GtkTreeIter
+ * @key_len: return location for the key length
+ *
+ * Returns the primary key of the row at @iter, a db_recno_t for
+ * DB_RECNO stores or the application key for keyed stores.
+ *
+ * Return value: a newly allocated copy of the key, free with g_free().
+ */
+gpointer
+bdb_list_store_get_key (BdbListStore *self, GtkTreeIter *iter, gsize *key_len)
 {
 	g_return_val_if_fail (BDB_IS_LIST_STORE (self), NULL);
-	return LIST_STORE_PRIVATE (self)->dbp;
+	
+	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	g_return_val_if_fail (priv->stamp == iter->stamp, NULL);
+	
+	DBT key;
+	gint ret;
+	
+	if ((ret = get_primary_key (self, GPOINTER_TO_INT (iter->user_data), &key)) != 0) {
+		g_warning ("bdb_list_store_get_key: %s", db_strerror (ret));
+		return NULL;
+	}
+	
+	if (key_len)
+		*key_len = key.size;
+	
+	return key.data;
 }
 
+/**
+ * bdb_list_store_insert_with_key:
+ * @self: A #BdbListStore backed by a DB_BTREE
+ * @iter: return location for the new row
+ * @key: the application key for the row
+ * @key_len: the length of @key
+ *
+ * Inserts an empty row under @key. Keyed stores are ordered by their
+ * keys, so the row lands wherever the btree puts it and @iter points
+ * at that position.
+ *
+ * Return value: %FALSE if @key already exists or the put failed.
+ */
 gboolean
-bdb_list_store_set_db (BdbListStore *self, DB *db, GError **error)
+bdb_list_store_insert_with_key (BdbListStore  *self,
+                                GtkTreeIter   *iter,
+                                gconstpointer  key,
+                                gsize          key_len)
 {
 	g_return_val_if_fail (BDB_IS_LIST_STORE (self), FALSE);
-	g_return_val_if_fail (db != NULL, FALSE);
-	
-	if (db->type != DB_RECNO) {
-		if (error && *error == NULL)
-			*error = g_error_new_literal (BDB_QUARK, 0, "DB must be of type DB_RECNO");
-		return FALSE;
-	}
+	g_return_val_if_fail (key != NULL, FALSE);
 	
 	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
+	g_return_val_if_fail (priv->keyed, FALSE);
 	
-	if (priv->dbp != NULL) {
-		if (error && *error == NULL)
-			*error = g_error_new (BDB_QUARK, 0, "Cannot set db twice");
+	if (!check_not_loading (priv, G_STRFUNC))
 		return FALSE;
-	}
 	
-	guint flags = 0;
-	gint ret = 0;
+	DBT dbkey, data;
+	DB_TXN *txn = NULL;
+	GtkTreePath *path;
+	gint natural = 0;
+	gint index;
+	gint ret;
 	
-	if ((ret = db->get_flags (db, &flags)) != 0) {
-		if (error && *error == NULL)
-			*error = g_error_new (BDB_QUARK, 0, "Cannot retrieve db flags");
-		return FALSE;
-	}
+	CLEAR_DBT (dbkey);
+	CLEAR_DBT (data);
 	
-	if (!(flags & DB_RENUMBER)) {
-		if (error && *error == NULL)
-			*error = g_error_new (BDB_QUARK, 0, "Please alter DB with db->set_flags(DB_RENUMBER)");
+	worker_flush (self);
+	
+	dbkey.data = (void*)key;
+	dbkey.size = key_len;
+	dbkey.ulen = key_len;
+	dbkey.flags = DB_DBT_USERMEM;
+	
+	data.data = "";
+	data.size = sizeof (char);
+	data.ulen = data.size;
+	data.flags = DB_DBT_USERMEM;
+	
+	if ((ret = priv->dbp->put (priv->dbp, txn, &dbkey, &data, DB_NOOVERWRITE)) != 0) {
+		if (ret != DB_KEYEXIST)
+			g_warning ("bdb_list_store_insert_with_key: %s", db_strerror (ret));
 		return FALSE;
 	}
 	
-	priv->dbp = db;
+	adjust_n_keys (priv, 1);
+	
+	if (priv->log != NULL || !is_sorted (priv))
+		natural = key_to_recno (priv->dbp, &dbkey);
+	
+	change_log_append (priv->log, priv->writer, CHANGE_INSERTED, natural, 1);
+	
+	if (is_sorted (priv))
+		index = sorted_index (self, &dbkey, &data);
+	else
+		index = natural;
+	
+	/*
+	 * The row is stored and counted, so views must hear about it even if
+	 * its position could not be read back; the tail is the last resort.
+	 */
+	if (index == 0 && natural == 0 && is_sorted (priv))
+		natural = key_to_recno (priv->dbp, &dbkey);
+	if (index == 0)
+		index = (natural != 0) ? natural : get_n_keys (self);
+	
+	/* rows after the new key move down by one */
+	cache_invalidate_from (priv, index);
+	
+	iter->stamp = priv->stamp;
+	iter->user_data = GINT_TO_POINTER (index);
+	
+	path = gtk_tree_model_get_path (GTK_TREE_MODEL (self), iter);
+	gtk_tree_model_row_inserted (GTK_TREE_MODEL (self), path, iter);
+	gtk_tree_path_free (path);
 	
 	return TRUE;
 }
@@ -350,11 +3173,22 @@ bdb_list_store_append (BdbListStore *self, GtkTreeIter *iter)
 	
 	BdbListStorePrivate *priv = LIST_STORE_PRIVATE (self);
 	
+	if (priv->keyed) {
+		g_warning ("bdb_list_store_append: keyed stores insert with "
+		           "bdb_list_store_insert_with_key()");
+		return;
+	}
+	
+	if (!check_not_loading (priv, G_STRFUNC))
+		return;
+	
 	DBT key, data;
 	DB_TXN *txn = NULL;
 	db_recno_t recno;
 	gint ret;
 	
+	worker_flush (self);
+	
 	CLEAR_DBT (key);
 	CLEAR_DBT (data);
 	
@@ -371,11 +3205,21 @@ bdb_list_store_append (BdbListStore *self, GtkTreeIter *iter)
 	
 	if ((ret = priv->dbp->put (priv->dbp, txn, &key, &data, DB_APPEND)) != 0)
 		g_warning ("bdb_list_store_append: %s", db_strerror (ret));
+	else
+		change_log_append (priv->log, priv->writer, CHANGE_INSERTED, recno, 1);
 	
-	priv->dirty = TRUE;
+	adjust_n_keys (priv, ret == 0 ? 1 : 0);
 	
 	iter->stamp = priv->stamp;
-	iter->user_data = GINT_TO_POINTER (get_n_keys (self));
+	
+	if (is_sorted (priv)) {
+		gint index = sorted_index (self, &key, &data);
+		cache_invalidate_from (priv, index);
+		iter->user_data = GINT_TO_POINTER (index);
+	}
+	else {
+		iter->user_data = GINT_TO_POINTER (get_n_keys (self));
+	}
 	
 	FREE_DBT (key);
 	FREE_DBT (data);
@@ -397,35 +3241,92 @@ bdb_list_store_set_value (BdbListStore *self,
 	g_return_if_fail (priv->stamp == iter->stamp);
 	g_return_if_fail (G_VALUE_HOLDS_STRING (value));
 	
+	if (!check_not_loading (priv, G_STRFUNC))
+		return;
+	
 	DBT key, data;
 	DB_TXN *txn = NULL;
-	db_recno_t recno = GPOINTER_TO_INT (iter->user_data);
+	gint index = GPOINTER_TO_INT (iter->user_data);
+	gint new_index = index;
 	const gchar *str = g_value_get_string (value);
+	gsize len = strlen (str) + 1;
+	gpointer packed;
+	GtkTreePath *path;
+	DBT plain;
 	gint ret = 0;
 	
-	CLEAR_DBT (key);
-	CLEAR_DBT (value);
+	CLEAR_DBT (data);
+	CLEAR_DBT (plain);
 	
-	key.data = &recno;
-	key.size = sizeof (db_recno_t);
-	key.ulen = key.size;
-	key.flags = DB_DBT_USERMEM;
+	/* sorted rows may move, which needs the index to be current */
+	if (is_sorted (priv))
+		worker_flush (self);
 	
-	data.data = (void*)str;
-	data.size = strlen (str) + 1;
-	data.ulen = data.size;
-	data.flags = DB_DBT_USERMEM;
+	if ((ret = get_primary_key (self, index, &key)) != 0) {
+		g_warning ("bdb_list_store_set_value: %s", db_strerror (ret));
+		return;
+	}
+	
+	packed = value_encode (priv->codec, str, len, &data);
+	
+	if (priv->worker != NULL && !is_sorted (priv)) {
+		Op *op = g_slice_new0 (Op);
+		
+		op->type = OP_WRITE;
+		op->src.dbp = priv->dbp;
+		op->key = key;
+		op->str = packed ? packed : g_strdup (str);
+		op->len = data.size;
+		op->index = index;
+		op->log = priv->log;
+		op->writer = priv->writer;
+		worker_push (priv->worker, op);
+		
+		/* reads queued before the write would bring back the old row */
+		priv->generation++;
+		cache_insert (priv, index, g_strdup (str), len);
+		
+		path = gtk_tree_model_get_path (GTK_TREE_MODEL (self), iter);
+		gtk_tree_model_row_changed (GTK_TREE_MODEL (self), path, iter);
+		gtk_tree_path_free (path);
+		return;
+	}
 	
-	if ((ret = priv->dbp->put (priv->dbp, txn, &key, &data, 0)) != 0)
+	if ((ret = priv->dbp->put (priv->dbp, txn, &key, &data, 0)) != 0) {
 		g_warning ("bdb_list_store_set_value: %s", db_strerror (ret));
-	else
-		priv->dirty = TRUE;
+		cache_invalidate (priv, index);
+	}
+	else {
+		/* the log speaks in natural positions, whatever the local order */
+		if (priv->log != NULL)
+			change_log_append (priv->log, priv->writer, CHANGE_CHANGED,
+			                   is_sorted (priv) ? key_to_recno (priv->dbp, &key) : index, 1);
+		plain.data = (void*)str;
+		plain.size = len;
+		if (is_sorted (priv) && (new_index = sorted_index (self, &key, &plain)) == 0)
+			new_index = index;
+		cache_invalidate_range (priv, MIN (index, new_index), MAX (index, new_index));
+		cache_insert (priv, new_index, g_strdup (str), len);
+	}
 	
 	FREE_DBT (key);
-	FREE_DBT (data);
+	g_free (packed);
 	
-	GtkTreePath *path = gtk_tree_model_get_path (GTK_TREE_MODEL (self), iter);
-	gtk_tree_model_row_changed (GTK_TREE_MODEL (self), path, iter);
+	if (new_index == index) {
+		path = gtk_tree_model_get_path (GTK_TREE_MODEL (self), iter);
+		gtk_tree_model_row_changed (GTK_TREE_MODEL (self), path, iter);
+		gtk_tree_path_free (path);
+		return;
+	}
+	
+	/* the new contents moved the row within the index */
+	path = gtk_tree_path_new_from_indices (index - 1, -1);
+	gtk_tree_model_row_deleted (GTK_TREE_MODEL (self), path);
+	gtk_tree_path_free (path);
+	
+	iter->user_data = GINT_TO_POINTER (new_index);
+	path = gtk_tree_model_get_path (GTK_TREE_MODEL (self), iter);
+	gtk_tree_model_row_inserted (GTK_TREE_MODEL (self), path, iter);
 	gtk_tree_path_free (path);
 }
 
@@ -436,24 +3337,37 @@ bdb_list_store_remove (BdbListStore *self, GtkTreeIter *iter)
 	g_return_val_if_fail (priv->stamp == iter->stamp, FALSE);
 	g_return_val_if_fail (priv->dbp != NULL, FALSE);
 	
+	if (!check_not_loading (priv, G_STRFUNC))
+		return FALSE;
+	
 	DBT key;
 	DB_TXN *txn = NULL;
 	gint ret = 0;
 	gint flags = 0;
 	GtkTreePath *path;
+	gint index = GPOINTER_TO_INT (iter->user_data);
+	gint natural = 0;
 	
-	CLEAR_DBT (key);
+	worker_flush (self);
 	
-	db_recno_t recno = GPOINTER_TO_INT (iter->user_data);
-	key.data = &recno;
-	key.size = sizeof (db_recno_t);
-	key.ulen = key.size;
-	key.flags = DB_DBT_USERMEM;
+	if ((ret = get_primary_key (self, index, &key)) != 0) {
+		g_warning ("Could not remove: %s", db_strerror (ret));
+		return FALSE;
+	}
+	
+	/* the position is gone once the row is */
+	if (priv->log != NULL)
+		natural = is_sorted (priv) ? key_to_recno (priv->dbp, &key) : index;
 	
 	if ((ret = priv->dbp->del (priv->dbp, txn, &key, flags)) != 0)
 		g_warning ("Could not remove ");
+	else
+		change_log_append (priv->log, priv->writer, CHANGE_DELETED, natural, 1);
 	
-	priv->dirty = TRUE;
+	/* every following row moves up by one */
+	cache_invalidate_from (priv, index);
+	
+	adjust_n_keys (priv, ret == 0 ? -1 : 0);
 	path = get_path (GTK_TREE_MODEL (self), iter);
 	
 	gboolean is_valid = FALSE;
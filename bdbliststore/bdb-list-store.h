@@ -3,6 +3,7 @@
 
 #include <glib-object.h>
 #include <gtk/gtktreemodel.h>
+#include <gtk/gtktreesortable.h>
 #include <db.h>
 
 G_BEGIN_DECLS
@@ -35,6 +36,13 @@ G_BEGIN_DECLS
 typedef struct _BdbListStore      BdbListStore;
 typedef struct _BdbListStoreClass BdbListStoreClass;
 
+typedef void (*BdbListStoreLoadFunc) (BdbListStore *self,
+                                      goffset       loaded,
+                                      goffset       total,
+                                      gboolean      finished,
+                                      const GError *error,
+                                      gpointer      user_data);
+
 struct _BdbListStore
 {
 	GObject parent;
@@ -49,9 +57,46 @@ GType         bdb_list_store_get_type  (void);
 BdbListStore* bdb_list_store_new       (void);
 
 void          bdb_list_store_append    (BdbListStore *self, GtkTreeIter *iter);
+gboolean      bdb_list_store_insert_with_key (BdbListStore  *self,
+                                              GtkTreeIter   *iter,
+                                              gconstpointer  key,
+                                              gsize          key_len);
+gpointer      bdb_list_store_get_key   (BdbListStore *self,
+                                        GtkTreeIter  *iter,
+                                        gsize        *key_len);
 gboolean      bdb_list_store_remove    (BdbListStore *self, GtkTreeIter *iter);
 gboolean      bdb_list_store_set_db    (BdbListStore *self, DB *db, GError **error);
 DB*           bdb_list_store_get_db    (BdbListStore *self);
+gboolean      bdb_list_store_set_sort_db (BdbListStore *self, DB *sdb, GError **error);
+DB*           bdb_list_store_get_sort_db (BdbListStore *self);
+void          bdb_list_store_set_cache_size (BdbListStore *self, gsize bytes);
+gsize         bdb_list_store_get_cache_size (BdbListStore *self);
+gboolean      bdb_list_store_set_change_log (BdbListStore *self,
+                                             DB           *log,
+                                             GError      **error);
+DB*           bdb_list_store_get_change_log (BdbListStore *self);
+gboolean      bdb_list_store_set_compression (BdbListStore  *self,
+                                              gint           level,
+                                              GBytes        *dictionary,
+                                              GError       **error);
+GBytes*       bdb_list_store_train_dictionary (BdbListStore *self,
+                                               gsize         max_size,
+                                               GError      **error);
+gboolean      bdb_list_store_set_threaded   (BdbListStore *self,
+                                             gboolean      threaded,
+                                             GError      **error);
+gboolean      bdb_list_store_get_threaded   (BdbListStore *self);
+void          bdb_list_store_set_visible_range (BdbListStore *self,
+                                                GtkTreePath  *start,
+                                                GtkTreePath  *end);
+gboolean      bdb_list_store_load_file (BdbListStore          *self,
+                                        const gchar           *filename,
+                                        BdbListStoreLoadFunc   func,
+                                        gpointer               user_data,
+                                        GDestroyNotify         notify,
+                                        GError               **error);
+void          bdb_list_store_cancel_load (BdbListStore *self);
+gboolean      bdb_list_store_is_loading  (BdbListStore *self);
 void          bdb_list_store_set_value (BdbListStore *self,
                                         GtkTreeIter  *iter,
                                         gint          column,
@@ -9,6 +9,8 @@
 
 static BdbListStore *store    = NULL;
 static GtkWidget    *treeview = NULL;
+static GtkWidget    *progress = NULL;
+static gboolean      keyed    = FALSE;
 
 void
 add_clicked (GtkButton *add)
@@ -16,7 +18,14 @@ add_clicked (GtkButton *add)
 	GtkTreeIter iter;
 	GValue value = {0,};
 	
-	bdb_list_store_append (store, &iter);
+	if (keyed) {
+		guint64 key = GUINT64_TO_BE (g_get_real_time ());
+		if (!bdb_list_store_insert_with_key (store, &iter, &key, sizeof (key)))
+			return;
+	}
+	else {
+		bdb_list_store_append (store, &iter);
+	}
 	
 	g_value_init (&value, G_TYPE_STRING);
 	g_value_take_string (&value, g_strdup_printf ("This is row %d", GPOINTER_TO_INT (iter.user_data)));
@@ -40,10 +49,79 @@ remove_clicked (GtkButton *remove)
 	}
 }
 
+static void
+load_progress (BdbListStore *store,
+               goffset       loaded,
+               goffset       total,
+               gboolean      finished,
+               const GError *error,
+               gpointer      user_data)
+{
+	if (error)
+		g_printerr ("Load stopped: %s\n", error->message);
+	
+	gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (progress),
+	                               total ? (gdouble)loaded / total : 1.0);
+	
+	if (finished)
+		gtk_widget_hide (progress);
+}
+
+void
+load_clicked (GtkButton *load)
+{
+	GtkWidget *dialog;
+	gchar     *filename;
+	GError    *error = NULL;
+	
+	dialog = gtk_file_chooser_dialog_new ("Load Lines", NULL,
+	                                      GTK_FILE_CHOOSER_ACTION_OPEN,
+	                                      GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+	                                      GTK_STOCK_OPEN, GTK_RESPONSE_ACCEPT,
+	                                      NULL);
+	
+	if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT) {
+		filename = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (dialog));
+		
+		if (bdb_list_store_load_file (store, filename, load_progress, NULL, NULL, &error)) {
+			gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (progress), 0.0);
+			gtk_widget_show (progress);
+		}
+		else {
+			g_printerr ("Could not load %s: %s\n", filename, error->message);
+			g_clear_error (&error);
+		}
+		
+		g_free (filename);
+	}
+	
+	gtk_widget_destroy (dialog);
+}
+
+static void
+scrolled (GtkAdjustment *adj)
+{
+	GtkTreePath *start, *end;
+	
+	if (gtk_tree_view_get_visible_range (GTK_TREE_VIEW (treeview), &start, &end)) {
+		bdb_list_store_set_visible_range (store, start, end);
+		gtk_tree_path_free (start);
+		gtk_tree_path_free (end);
+	}
+}
+
 void quit (void)
 {
 	DB *db = bdb_list_store_get_db (store);
+	DB *sdb = bdb_list_store_get_sort_db (store);
+	DB *log = bdb_list_store_get_change_log (store);
 	g_assert (db != NULL);
+	bdb_list_store_cancel_load (store);
+	bdb_list_store_set_threaded (store, FALSE, NULL);
+	if (sdb != NULL)
+		sdb->close (sdb, 0);
+	if (log != NULL)
+		log->close (log, 0);
 	db->close (db, 0);
 	gtk_main_quit ();
 }
@@ -59,10 +137,14 @@ main (int argc, char *argv[])
 	GtkWidget         *hbox;
 	GtkWidget         *add;
 	GtkWidget         *remove;
+	GtkWidget         *load;
 	GError            *error = NULL;
 	
 	gtk_init (&argc, &argv);
 	
+	/* --keyed uses a DB_BTREE with stable keys and a sortable column */
+	keyed = (argc > 1 && g_str_equal (argv[1], "--keyed"));
+	
 	window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
 	gtk_container_set_border_width (GTK_CONTAINER (window), 12);
 	g_signal_connect (window, "destroy", G_CALLBACK (quit), NULL);
@@ -93,6 +175,9 @@ main (int argc, char *argv[])
 	gtk_tree_view_column_add_attribute (column, ctext, "text", 0);
 	gtk_tree_view_append_column (GTK_TREE_VIEW (treeview), column);
 	
+	if (keyed)
+		gtk_tree_view_column_set_sort_column_id (column, 0);
+	
 	hbox = gtk_hbox_new (TRUE, 2);
 	gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, TRUE, 0);
 	gtk_widget_show (hbox);
@@ -107,7 +192,20 @@ main (int argc, char *argv[])
 	gtk_box_pack_start (GTK_BOX (hbox), remove, TRUE, TRUE, 0);
 	gtk_widget_show (remove);
 	
+	/* files load into the renumbered recno store */
+	if (!keyed) {
+		load = gtk_button_new_from_stock (GTK_STOCK_OPEN);
+		g_signal_connect (load, "clicked", G_CALLBACK (load_clicked), NULL);
+		gtk_box_pack_start (GTK_BOX (hbox), load, TRUE, TRUE, 0);
+		gtk_widget_show (load);
+	}
+	
+	progress = gtk_progress_bar_new ();
+	gtk_box_pack_start (GTK_BOX (vbox), progress, FALSE, TRUE, 0);
+	
 	DB     *dbp          = NULL;
+	DB     *sdbp         = NULL;
+	DB     *logp         = NULL;
 	DB_ENV *db_env       = NULL;
 	int     ret          = 0;
 	int     db_env_flags = DB_CREATE
@@ -115,7 +213,7 @@ main (int argc, char *argv[])
 			     | DB_INIT_LOCK
 			     | DB_INIT_MPOOL
 			     | DB_INIT_TXN
-			     | DB_PRIVATE;
+			     | DB_THREAD;
 	
 	if ((ret = db_env_create (&db_env, 0)) != 0)
 		g_error ("db_env_create: %s", db_strerror (ret));
@@ -129,9 +227,16 @@ main (int argc, char *argv[])
 	if ((ret = db_create (&dbp, db_env, 0)) != 0)
 		g_error ("db_create: %s", db_strerror (ret));
 	
-	dbp->set_flags (dbp, DB_RENUMBER);
-
-	if ((ret = dbp->open (dbp, NULL, "test.db", NULL, DB_RECNO, DB_CREATE, 0)) != 0)
+	if (keyed) {
+		dbp->set_flags (dbp, DB_RECNUM);
+		ret = dbp->open (dbp, NULL, "keyed.db", NULL, DB_BTREE, DB_CREATE | DB_THREAD, 0);
+	}
+	else {
+		dbp->set_flags (dbp, DB_RENUMBER);
+		ret = dbp->open (dbp, NULL, "test.db", NULL, DB_RECNO, DB_CREATE | DB_THREAD, 0);
+	}
+	
+	if (ret != 0)
 		g_error ("db_open: %s", db_strerror (ret));
 	
 	store = bdb_list_store_new ();
@@ -143,6 +248,49 @@ main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 	
+	/* run several demos side by side and watch each other's edits */
+	if ((ret = db_create (&logp, db_env, 0)) != 0)
+		g_error ("db_create: %s", db_strerror (ret));
+	
+	if ((ret = logp->open (logp, NULL, keyed ? "keyed-changes.db" : "changes.db",
+	                       NULL, DB_RECNO, DB_CREATE | DB_THREAD, 0)) != 0)
+		g_error ("db_open: %s", db_strerror (ret));
+	
+	if (!bdb_list_store_set_change_log (store, logp, &error)) {
+		g_printerr ("Could not attach change log: %s\n", error->message);
+		g_clear_error (&error);
+	}
+	
+	/* loaded logs are repetitive; pack the longer lines */
+	bdb_list_store_set_compression (store, 3, NULL, NULL);
+	
+	if (keyed) {
+		if ((ret = db_create (&sdbp, db_env, 0)) != 0)
+			g_error ("db_create: %s", db_strerror (ret));
+		
+		sdbp->set_flags (sdbp, DB_RECNUM);
+		
+		if ((ret = sdbp->open (sdbp, NULL, "keyed-sort.db", NULL, DB_BTREE, DB_CREATE | DB_THREAD, 0)) != 0)
+			g_error ("db_open: %s", db_strerror (ret));
+		
+		if (!bdb_list_store_set_sort_db (store, sdbp, &error)) {
+			if (error) {
+				g_printerr ("Could not attach sort database: %s\n", error->message);
+				g_error_free (error);
+			}
+			return EXIT_FAILURE;
+		}
+	}
+	
+	/* read rows off the main loop, prefetching around what is on screen */
+	if (!bdb_list_store_set_threaded (store, TRUE, &error)) {
+		g_printerr ("Could not start I/O thread: %s\n", error->message);
+		g_clear_error (&error);
+	}
+	
+	g_signal_connect (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (scroller)),
+	                  "value-changed", G_CALLBACK (scrolled), NULL);
+	
 	gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), GTK_TREE_MODEL (store));
 
 	gtk_main ();
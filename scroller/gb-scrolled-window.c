@@ -222,6 +222,7 @@ gb_scrolled_window_enter_notify (GtkWidget        *widget,
                                           500,
                                           "value", upper,
                                           NULL);
+   gb_animation_set_widget(priv->opacity_anim, GTK_WIDGET(window));
    g_object_add_weak_pointer(G_OBJECT(priv->opacity_anim),
                              (gpointer *)&priv->opacity_anim);
 
@@ -246,6 +247,7 @@ gb_scrolled_window_leave_notify (GtkWidget        *widget,
                                           1000,
                                           "value", 0.0,
                                           NULL);
+   gb_animation_set_widget(priv->opacity_anim, GTK_WIDGET(window));
    g_object_add_weak_pointer(G_OBJECT(priv->opacity_anim),
                              (gpointer *)&priv->opacity_anim);
 
@@ -367,18 +369,20 @@ gb_scrolled_window_scroll_event (GtkWidget      *widget,
    delta = gb_scrolled_window_get_wheel_delta(adj, event->direction);
    value = gtk_adjustment_get_value(adj);
 
+   /*
+    * Steer the running animation towards the new target rather than
+    * starting another one for every notch; it keeps its velocity.
+    */
    if (*anim) {
-      g_object_remove_weak_pointer(G_OBJECT(*anim), (gpointer *)anim);
-      gb_animation_stop(*anim);
-      *anim = NULL;
-      value = *target;
+      value = *target + delta;
+      gb_animation_retarget(*anim, "value", value, NULL);
+   } else {
+      value += delta;
+      *anim = gb_object_animate(adj, GB_ANIMATION_EASE_OUT_QUAD, 200,
+                                "value", value,
+                                NULL);
+      g_object_add_weak_pointer(G_OBJECT(*anim), (gpointer *)anim);
    }
-
-   value += delta;
-   *anim = gb_object_animate(adj, GB_ANIMATION_EASE_OUT_QUAD, 200,
-                             "value", value,
-                             NULL);
-   g_object_add_weak_pointer(G_OBJECT(*anim), (gpointer *)anim);
    *target = value;
 
    {